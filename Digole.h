@@ -12,6 +12,8 @@
 #include <Arduino.h>
 #include <Print.h>
 
+#include "Digole_config.h"
+
 #if defined(DIGOLE_I2C) && DIGOLE_I2C
 #include <Wire.h>
 #endif // DIGOLE_I2C
@@ -20,16 +22,33 @@
 #include <SPI.h>
 #endif // DIGOLE_SPI
 
-#include "Digole_config.h"
+// Commands are encoded in a scratch buffer.  When reentrant, each call gets
+// its own on the stack; otherwise all calls share a single static buffer
+// (command templates are copied from flash, so they cost no RAM either).
+#define DIGOLE_SCRATCH_SIZE 16
 
 #if defined(REENTRANT) && REENTRANT
-#  define _STATICBUF
+#  define _SCRATCH(name, size) uint8_t name[size]
+#  define _CMDBUF(name, size, ...) uint8_t name[size] = { __VA_ARGS__ }
 #else
-#  define _STATICBUF static
+#  define _SCRATCH(name, size) \
+     static_assert((size) <= DIGOLE_SCRATCH_SIZE, "Scratch buffer too small"); \
+     uint8_t *name = Digole::_scratchBuffer()
+#  define _CMDBUF(name, size, ...) \
+     static const uint8_t name##_init[size] PROGMEM = { __VA_ARGS__ }; \
+     _SCRATCH(name, size); \
+     memcpy_P(name, name##_init, size)
 #endif
 
 namespace Digole {
 
+#if !(defined(REENTRANT) && REENTRANT)
+inline uint8_t *_scratchBuffer() {
+  static uint8_t buf[DIGOLE_SCRATCH_SIZE];
+  return buf;
+}
+#endif
+
 struct Color {
   uint8_t r, g, b;
 
@@ -105,24 +124,66 @@ enum lcd_chip_t : uint8_t {
   
 template <class COM>
 class DigoleDisplay : public Print {
+  static_assert(DIGOLE_TEXT_BUFFER >= 0 && DIGOLE_TEXT_BUFFER <= 255,
+                "DIGOLE_TEXT_BUFFER must be 0 to 255");
+
 public:
+  // Preferred size of a single bulk write; backends may redefine it
+  const static uint16_t TRANSFER_SIZE = 32;
+
+  DigoleDisplay() :
+    _after_cr(false)
+#if DIGOLE_TEXT_BUFFER > 0
+    , _text_len(0)
+#endif
+#if DIGOLE_ENABLE_INTERACTIVE
+    , _interactive(NULL), _interactive_ctx(NULL),
+    _bulk_slice(DIGOLE_BULK_SLICE), _in_interactive(false)
+#endif
+#if DIGOLE_ENABLE_STATS
+    , _bytes_written(0)
+#endif
+  {
+#if DIGOLE_TEXT_BUFFER > 0
+    _text[0] = 'T';
+    _text[1] = 'T';
+#endif
+  }
 
-  // The following four methods implement compile-time inheritance
+  // The following five methods implement compile-time inheritance
   // (inspired by http://hackaday.io/project/6038 ; see also
   //  https://en.wikipedia.org/wiki/Curiously_recurring_template_pattern)
+  // Any buffered text goes out first, so commands stay in order.
   inline size_t writeRaw (uint8_t c) {
-    return (static_cast<COM*>(this))->_writeRaw(c);
+    flushText();
+    size_t n = (static_cast<COM*>(this))->_writeRaw(c);
+    _count(n);
+    return n;
   }
   inline size_t writeRaw (const uint8_t *buffer, size_t size) {
-    return (static_cast<COM*>(this))->_writeRaw(buffer, size);
+    flushText();
+    size_t n = (static_cast<COM*>(this))->_writeRaw(buffer, size);
+    _count(n);
+    return n;
   }
   inline uint8_t read() {
+    flushText();
     return (static_cast<COM*>(this))->_read(); 
   }
   inline uint16_t readInt() {
+    flushText();
     return (static_cast<COM*>(this))->_readInt();
   }
+  // Waits until everything written so far has actually gone out
+  inline void drain() {
+    flush();
+    (static_cast<COM*>(this))->_drain();
+  }
 
+#if DIGOLE_ENABLE_STATS
+  // Total bytes handed to the backend so far
+  inline uint32_t bytesWritten() const { return _bytes_written; }
+#endif
 
   inline size_t writeRaw(const char *str) {
     if (str == NULL) return 0;
@@ -134,7 +195,7 @@ public:
   }
 
   inline size_t writeRawInt(uint16_t v) {
-    _STATICBUF uint8_t buf[2];
+    _SCRATCH(buf, 2);
     size_t s = copyRawInt(buf, v);
     return writeRaw(buf, s);
   }
@@ -157,48 +218,73 @@ public:
 
   /**** Print virtual methods ****/
 
+  // Printed text is accumulated and sent as a single TT command when a
+  // newline or any other command comes along, when the buffer fills up,
+  // or on flush().  Call flush() if nothing else follows the text.
+  // With DIGOLE_TEXT_BUFFER set to 0, each run of text in a write() call
+  // goes out right away as its own TT command instead.
+
   size_t write(uint8_t c) override {
-    if (c == '\r' || c =='\n') {
-      _newline();
-    } else {
-      _STATICBUF char buf[4] = {'T', 'T', 'c', '\x0d'};
-      buf[2] = c;
-      return (writeRaw(buf, 4) > 0) ? 1 : 0;
-    }
+    return write(&c, 1);
   }
 
+  // Text between newlines is found with memchr() and handled a run at a
+  // time.  Note: unlike Unix, the '\r' is interpreted the same way as an '\n'
   size_t write(const uint8_t *buffer, size_t size) override {
-    
-    const uint8_t *p = buffer;
-
+    const uint8_t *p = buffer, *end = buffer + size;
+    // Next of each newline character; each is searched for past the last
+    // one found, so every byte is scanned at most once per character
+    const uint8_t *cr = _find(p, end, '\r'), *lf = _find(p, end, '\n');
     while (true) {
-      const uint8_t *endl;
-      // Look for newline or for end of buffer
-      // Note: unlike Unix, the '\r' is interpreted the same way as an '\n'
-      for (endl = p; (endl < buffer + size) && *endl != '\n' && *endl != '\r'; endl++)
-        ;
-      // Write this line's text, if non-empty
-      if (endl > p) {
-        writeRaw("TT", 2);
-        writeRaw(p, endl - p);
-        writeRaw('\x0d');
+      const uint8_t *nl = (cr < lf) ? cr : lf;
+      if (nl > p) {
+        _writeText(p, nl - p);
+        _after_cr = false;
       }
-      // Advance index pointer
-      p = endl;
+      if (nl == end)
+        return size;
+      // Treat the "\r\n" sequence as one newline, even across calls
+      if (*nl == '\r' || !_after_cr)
+        _newline();
+      _after_cr = (*nl == '\r');
+      p = nl + 1;
+      if (nl == cr)
+        cr = _find(p, end, '\r');
+      else
+        lf = _find(p, end, '\n');
+    }
+  }
 
-      // If string ended, stop
-      if (p >= buffer + size)
-        break;
+  void flush() {
+    flushText();
+  }
 
-      // Else, there must have been a newline
-      _newline();
-      p += 1; // Skip the '\r' or '\n'
-      // Treat the "\r\n" sequence as one newline
-      if (p[-1] == '\r' || p[0] == '\n') {
-        p += 1;  // Skip an extra character, the '\n'
-      }
-    }
+  inline void flushText() {
+    _after_cr = false;
+#if DIGOLE_TEXT_BUFFER > 0
+    if (_text_len > 0)
+      _flushText();
+#endif
+  }
+
+
+  /**** Interactive vs bulk transfers ****/
+
+  // While a bitmap or flash write is in progress, the handler is called
+  // between slices of (roughly) slice bytes, so that it can read the
+  // touchscreen or issue small updates without waiting for the whole
+  // transfer.  Slices are complete commands, so this is protocol-safe,
+  // but the handler must restore any state it changes (color, draw mode,
+  // draw window).  Bulk transfers started from the handler aren't sliced.
+  // Font and start screen uploads can't be split, so they never yield.
+#if DIGOLE_ENABLE_INTERACTIVE
+  void setInteractiveHandler(void (*handler)(void *), void *ctx = NULL,
+                             uint16_t slice = DIGOLE_BULK_SLICE) {
+    _interactive = handler;
+    _interactive_ctx = ctx;
+    _bulk_slice = (slice > 0) ? slice : 1;
   }
+#endif
 
 
   /**** Settings ****/
@@ -212,25 +298,25 @@ public:
   }
 
   void setRotation(orientation_t orient) {
-    _STATICBUF uint8_t cmd[3] = { 'S', 'D', 'x' };  // w/o 'x' machine code is larger
+    _CMDBUF(cmd, 3, 'S', 'D', 'x');  // w/o 'x' machine code is larger
     cmd[2] = orient;
     writeRaw(cmd, 3);
   }
 
   void setContrast(uint8_t v) {
-    _STATICBUF uint8_t cmd[3] = { 'C', 'T', 'x' };
+    _CMDBUF(cmd, 3, 'C', 'T', 'x');
     cmd[2] = v;
     writeRaw(cmd, 3);
   }
 
   void setBacklight(uint8_t v) {
-    _STATICBUF uint8_t cmd[3] = { 'B', 'L', 'x' };
+    _CMDBUF(cmd, 3, 'B', 'L', 'x');
     cmd[2] = v;
     writeRaw(cmd, 3);
   }
 
   void setColor(uint8_t r, uint8_t g, uint8_t b) {
-     _STATICBUF uint8_t cmd[6] = { 'E', 'S', 'C', 'r', 'g', 'b' };
+     _CMDBUF(cmd, 6, 'E', 'S', 'C', 'r', 'g', 'b');
     cmd[3] = r;
     cmd[4] = g;
     cmd[5] = b;
@@ -239,7 +325,7 @@ public:
   }
 
   void setColor(uint8_t color) {
-    _STATICBUF uint8_t cmd[3] = { 'S', 'C', 'x' };
+    _CMDBUF(cmd, 3, 'S', 'C', 'x');
     cmd[2] = color;
     writeRaw(cmd, 3);
   }
@@ -257,7 +343,7 @@ public:
   }
 
   void setDrawMode(draw_mode_t mode) {
-    _STATICBUF uint8_t cmd[3] = { 'D', 'M', 'x' };
+    _CMDBUF(cmd, 3, 'D', 'M', 'x');
     cmd[2] = mode;
     writeRaw(cmd, 3);
   }
@@ -270,7 +356,7 @@ public:
   }
 
   void drawPixel(uint16_t x, uint16_t y, uint8_t color = 1) {
-    _STATICBUF uint8_t cmd[7] = { 'D', 'P', 'x', 'x', 'y', 'y', 'c' };
+    _CMDBUF(cmd, 7, 'D', 'P', 'x', 'x', 'y', 'y', 'c');
     uint8_t *p = cmd + 2;
     p += copyRawInt(p, x);
     p += copyRawInt(p, y);
@@ -280,9 +366,7 @@ public:
   }
 
   void drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
-    _STATICBUF uint8_t cmd[10] = {
-      'L', 'N', 'x', 'x', 'y', 'y', 'x', 'x', 'y', 'y'
-    };
+    _CMDBUF(cmd, 10, 'L', 'N', 'x', 'x', 'y', 'y', 'x', 'x', 'y', 'y');
     uint8_t *p = cmd + 2;
     p += copyRawInt(p, x0);
     p += copyRawInt(p, y0);
@@ -292,7 +376,7 @@ public:
   }
 
   void drawLineTo(uint16_t x, uint16_t y) {
-    _STATICBUF uint8_t cmd[6] = { 'L', 'T', 'x', 'x', 'y', 'y' };
+    _CMDBUF(cmd, 6, 'L', 'T', 'x', 'x', 'y', 'y');
     uint8_t *p = cmd + 2;
     p += copyRawInt(p, x);
     p += copyRawInt(p, y);
@@ -300,9 +384,7 @@ public:
   }
 
   void drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool filled = false) {
-    _STATICBUF uint8_t cmd[10] = {
-      'D', 'R', 'x', 'x', 'y', 'y', 'x', 'x', 'y', 'y'
-    };
+    _CMDBUF(cmd, 10, 'D', 'R', 'x', 'x', 'y', 'y', 'x', 'x', 'y', 'y');
     if (filled)
       cmd[0] = 'F';
     uint8_t *p = cmd + 2;
@@ -314,9 +396,7 @@ public:
   }
 
   void drawCircle(uint16_t x, uint16_t y, uint16_t r, bool filled = false) {
-    _STATICBUF uint8_t cmd[9] = {
-      'C', 'C', 'x', 'x', 'y', 'y', 'r', 'r', 'f'
-    };
+    _CMDBUF(cmd, 9, 'C', 'C', 'x', 'x', 'y', 'y', 'r', 'r', 'f');
     uint8_t *p = cmd + 2;
     p += copyRawInt(p, x);
     p += copyRawInt(p, y);
@@ -326,47 +406,30 @@ public:
     writeRaw(cmd, p - cmd);
   }
 
+  // If an interactive handler is set, large bitmaps are sent as several
+  // horizontal bands (each a complete command), and the handler runs in
+  // between; see setInteractiveHandler()
   void drawBitmap(bitmap_t type,
                   uint16_t x, uint16_t y, uint16_t w, uint16_t h,
                   const uint8_t *data) {
-    // TODO: Test
-    _STATICBUF uint8_t hdr[11] = {
-      'E', 'D', 'I', 'M', 'n', 'x', 'x', 'y', 'y', 'w', 'w', 'h', 'h'
-    };
-    uint8_t *p = 0;
-    switch (type) {
-    case BITMAP_8:
-      memcpy(hdr, "DIM", 3);
-      p = hdr + 3;
-      break;
-    case BITMAP_256:
-      hdr[4] = '1';
-      p = hdr + 5;
-      break;
-    case BITMAP_262K:
-      hdr[4] = '3';
-      p = hdr + 5;
-      break;
-    default:
-      assert(false);
-      // Should not happen!
-    } 
-    p += copyRawInt(x);
-    p += copyRawInt(y);
-    p += copyRawInt(w);
-    p += copyRawInt(h);
-    writeRaw(hdr, p - hdr);
-
-    const int num_bytes = (type == BITMAP_8) ? h * ((w + 7) / 8) : h * w;
-    for (int j = 0;  j < num_bytes;  j++)
-      writeRaw(pgm_read_byte_near(data+ j)); // TODO: Chunked?
+    const uint16_t row_bytes = (type == BITMAP_8) ? (w + 7) / 8 :
+                               (type == BITMAP_262K) ? 3 * w : w;
+    uint16_t band = h;
+    if (_slicing() && row_bytes > 0 && _sliceSize() / row_bytes < h)
+      band = (_sliceSize() > row_bytes) ? _sliceSize() / row_bytes : 1;
+
+    for (uint16_t row = 0;  row < h;  row += band) {
+      uint16_t n = (h - row > band) ? band : h - row;
+      if (row > 0)
+        _serviceInteractive();
+      _drawBitmapHeader(type, x, y + row, w, n);
+      _writeProgmem(data + (uint32_t)row * row_bytes, (uint32_t)n * row_bytes);
+    }
   }
 
   void moveArea (uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
                  uint8_t dx, uint8_t dy) {
-    _STATICBUF uint8_t cmd[12] = {
-      'M', 'A', 'x', 'x', 'y', 'y', 'x', 'x', 'y', 'y', 'd', 'd'
-    };
+    _CMDBUF(cmd, 12, 'M', 'A', 'x', 'x', 'y', 'y', 'x', 'x', 'y', 'y', 'd', 'd');
     uint8_t *p = cmd + 2;
     p += copyRawInt(p, x0);
     p += copyRawInt(p, y0);
@@ -380,13 +443,13 @@ public:
   }
 
   void setLinePattern(uint8_t pattern) {
-    _STATICBUF uint8_t cmd[4] = { 'S', 'L', 'P', 'p' };
+    _CMDBUF(cmd, 4, 'S', 'L', 'P', 'p');
     cmd[3] = pattern;
     writeRaw(cmd, 4);
   }
 
   void setGraphicsPosition(uint16_t x, uint16_t y) {
-    _STATICBUF uint8_t cmd[6] = { 'G', 'P', 'x', 'x', 'y', 'y' };
+    _CMDBUF(cmd, 6, 'G', 'P', 'x', 'x', 'y', 'y');
     uint8_t *p = cmd + 2;
     p += copyRawInt(p, x);
     p += copyRawInt(p, y);
@@ -395,9 +458,7 @@ public:
 
 
   void setDrawWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
-    _STATICBUF uint8_t cmd[13] = {
-      'D', 'W', 'W', 'I', 'N', 'x', 'x', 'y', 'y', 'w', 'w', 'h', 'h'
-    };
+    _CMDBUF(cmd, 13, 'D', 'W', 'W', 'I', 'N', 'x', 'x', 'y', 'y', 'w', 'w', 'h', 'h');
     uint8_t *p = cmd + 5;
     p += copyRawInt(p, x);
     p += copyRawInt(p, y);
@@ -418,13 +479,13 @@ public:
   /**** Text ****/
 
   void setFont(uint8_t font) {
-    _STATICBUF uint8_t cmd[3] = { 'S', 'F', 'x' };
+    _CMDBUF(cmd, 3, 'S', 'F', 'x');
     cmd[2] = font;
     writeRaw(cmd, 3);
   }
 
   void setTextPosition(uint16_t x, uint16_t y, text_position_t unit = CHARACTER) {
-    _STATICBUF uint8_t cmd[7] = { 'E', 'T', 'P', 'x', 'x', 'y', 'y' };
+    _CMDBUF(cmd, 7, 'E', 'T', 'P', 'x', 'x', 'y', 'y');
     uint8_t *p = cmd + 3;
     p += copyRawInt(p, x);
     p += copyRawInt(p, y);
@@ -439,13 +500,14 @@ public:
   }
 
   void setTextPositionOffset(uint8_t dx, uint8_t dy) {
-    _STATICBUF uint8_t cmd[5] = { 'E', 'T', 'O', 'x', 'y' };
+    _CMDBUF(cmd, 5, 'E', 'T', 'O', 'x', 'y');
     cmd[3] = dx;
     cmd[4] = dy;
     writeRaw(cmd, 5);
   }
 
 
+#if DIGOLE_ENABLE_TOUCH
   /**** Touchscreen ****/
 
   void calibrateTouchscreen() {
@@ -458,7 +520,7 @@ public:
   //   at least one of the coordinates will be larger than 0xff00
 
   void readTouchscreen(uint16_t &x, uint16_t &y, touch_mode_t mode) {
-    _STATICBUF uint8_t cmd[6] = { 'R', 'P', 'N', 'X', 'Y', 'm' };
+    _CMDBUF(cmd, 6, 'R', 'P', 'N', 'X', 'Y', 'm');
     cmd[5] = mode;
     writeRaw(cmd, 6);
     //delay(5);  // DEBUG; Wait for ADC
@@ -483,12 +545,15 @@ public:
   }
 
 
+#endif  // DIGOLE_ENABLE_TOUCH
+
+#if DIGOLE_ENABLE_UPLOAD
   /**** Fonts and splashscreen ****/
 
   void uploadStartScreen(const uint8_t *data, uint16_t length) {
-    _STATICBUF uint8_t hdr[5] = { 'S', 'S', 'S', 'l', 'l' };
-    hdr[3] = (uint8_t)(length && 0xff);
-    hdr[4] = (uint8_t)((length >> 8) && 0xff);
+    _CMDBUF(hdr, 5, 'S', 'S', 'S', 'l', 'l');
+    hdr[3] = (uint8_t)(length & 0xff);
+    hdr[4] = (uint8_t)((length >> 8) & 0xff);
     writeRaw(hdr, 5);
     delay(300);
     _writeData(data, length);
@@ -500,10 +565,10 @@ public:
     assert(section < 4 - length / 4096);
 
     while (true) {
-      _STATICBUF uint8_t hdr[6] = { 'S', 'U', 'F', 's', 'l', 'l' };
+      _CMDBUF(hdr, 6, 'S', 'U', 'F', 's', 'l', 'l');
       hdr[3] = section;
-      hdr[4] = (uint8_t)(length && 0xff);
-      hdr[5] = (uint8_t)((length >> 8) && 0xff);
+      hdr[4] = (uint8_t)(length & 0xff);
+      hdr[5] = (uint8_t)((length >> 8) & 0xff);
       writeRaw(hdr, 6);
       delay(200);
       _writeData(data, length);
@@ -530,11 +595,12 @@ public:
     }
   }
 
+#endif  // DIGOLE_ENABLE_UPLOAD
+
+#if DIGOLE_ENABLE_FLASH
   /**** Flash ****/
   void flashErase (uint32_t address, uint32_t length) {
-    _STATICBUF uint8_t buf[11] = {
-      'F', 'L', 'M', 'E', 'R', 'a', 'a', 'a', 'l', 'l', 'l'
-    };
+    _CMDBUF(buf, 11, 'F', 'L', 'M', 'E', 'R', 'a', 'a', 'a', 'l', 'l', 'l');
     _copyInt24(buf + 5, address);
     _copyInt24(buf + 8, length);
     writeRaw(buf, 11);
@@ -542,9 +608,7 @@ public:
 
   //void flashReadStart(unsigned long int addr, unsigned long int len);
   void flashRead(uint8_t *dest, uint32_t address, uint32_t length) {
-    _STATICBUF uint8_t buf[11] = {
-      'F', 'L', 'M', 'R', 'D', 'a', 'a', 'a', 'l', 'l', 'l'
-    };
+    _CMDBUF(buf, 11, 'F', 'L', 'M', 'R', 'D', 'a', 'a', 'a', 'l', 'l', 'l');
     _copyInt24(buf + 5, address);
     _copyInt24(buf + 8, length);
     writeRaw(buf, 11);
@@ -559,17 +623,25 @@ public:
     }
   }
 
+  // Data is sent in chunks of up to 1K (or the bulk slice size, if an
+  // interactive handler is set), each acknowledged by the display
   void flashWrite(uint32_t address, const uint8_t *data, uint32_t length) {
-    static const uint16_t chunk_size = 1024;
-
-    while (length > 1024) {
-      _flashWriteChunk(address, data, chunk_size);
-      data += chunk_size;
-      address += chunk_size;
-      length -= chunk_size;
+    const uint16_t chunk_size = (_slicing() && _sliceSize() < 1024) ? _sliceSize() : 1024;
+
+    while (length > 0) {
+      uint16_t n = (length > chunk_size) ? chunk_size : (uint16_t)length;
+      _flashWriteChunk(address, data, n);
+      data += n;
+      address += n;
+      length -= n;
+      if (length > 0)
+        _serviceInteractive();
     }
-    if (length > 0)
-      _flashWriteChunk(address, data, chunk_size);
+  }
+
+  // Same as flashWrite(), but from a buffer in RAM (at most 1K)
+  void flashWriteBuffer(uint32_t address, const uint8_t *buffer, uint16_t length) {
+    _flashWriteChunk(address, buffer, length, false);
   }
 
   // TODO: protected
@@ -580,72 +652,199 @@ public:
   }
 
   // TODO: protected
-  void _flashWriteChunk(uint32_t address, const uint8_t *data, uint16_t length) {
-    _STATICBUF uint8_t buf[11] = {
-      'F', 'L', 'M', 'W', 'R', 'a', 'a', 'a', 0, 'l', 'l'
-    };
+  void _flashWriteChunk(uint32_t address, const uint8_t *data, uint16_t length,
+                        bool progmem = true) {
+    _CMDBUF(buf, 11, 'F', 'L', 'M', 'W', 'R', 'a', 'a', 'a', 0, 'l', 'l');
     _copyInt24(buf + 5, address);
     _copyInt24(buf + 8, length);
     writeRaw(buf, 11);
-
-    for (uint16_t i = 0;  i < 0;  i++)
-      writeRaw(pgm_read_byte_near(data + i));
+    if (progmem)
+      _writeProgmem(data, length);
+    else
+      writeRaw(data, length);
 
     // Wait for ack (XON)
     while (read() != 17) yield();
   }
 
   void setFlashFont (uint32_t address) {
-    _STATICBUF uint8_t buf[6] = { 'S', 'F', 'F', 'a', 'a', 'a' };
+    _CMDBUF(buf, 6, 'S', 'F', 'F', 'a', 'a', 'a');
     _copyInt24(buf + 3, address);
     writeRaw(buf, 6);
   }
 
   void runFlashCommandSet (uint32_t address) {
-    _STATICBUF uint8_t buf[8] = {
-      'F', 'L', 'M', 'C', 'S', 'a', 'a', 'a'
-    };
+    _CMDBUF(buf, 8, 'F', 'L', 'M', 'C', 'S', 'a', 'a', 'a');
     _copyInt24(buf + 5, address);
     writeRaw(buf, 8);
   }
   
 
+#endif  // DIGOLE_ENABLE_FLASH
+
   /**** Low-level ****/
 
+#if DIGOLE_ENABLE_CHARLCD
   void setLCDChip(lcd_chip_t chip) {
-    _STATICBUF uint8_t cmd[5] = { 'S', 'L', 'C', 'D', 'x' };
+    _CMDBUF(cmd, 5, 'S', 'L', 'C', 'D', 'x');
     cmd[4] = chip;
     writeRaw(cmd, 5);
   }
 
   void setLCDSize(uint8_t cols, uint8_t rows) {
-    _STATICBUF uint8_t cmd[10] = {
-      'S', 'T', 'C', 'R', 'c', 'r', '\x80', '\xC0', '\x94', '\xD4'
-    };
+    _CMDBUF(cmd, 10, 'S', 'T', 'C', 'R', 'c', 'r', 0x80, 0xC0, 0x94, 0xD4);
     cmd[4] = cols;
     cmd[5] = rows;
     writeRaw(cmd, 10);
   }
 
   void sendRawCommand(uint8_t command) {
-    _STATICBUF uint8_t cmd[4] = { 'M', 'C', 'D', 'x' };
+    _CMDBUF(cmd, 4, 'M', 'C', 'D', 'x');
     cmd[3] = command;
     writeRaw(cmd, 4);
   }
 
   void sendRawData(uint8_t v) {
-    _STATICBUF uint8_t cmd[4] = { 'M', 'D', 'T', 'x' };
+    _CMDBUF(cmd, 4, 'M', 'D', 'T', 'x');
     cmd[3] = v;
     writeRaw(cmd, 4);
   }
 
+#endif  // DIGOLE_ENABLE_CHARLCD
+
   void digitalWrite(uint8_t v) {
-    _STATICBUF uint8_t cmd[5] = { 'D', 'O', 'U', 'T', 'x' };
+    _CMDBUF(cmd, 5, 'D', 'O', 'U', 'T', 'x');
     cmd[4] = v;
     writeRaw(cmd, 5);
   }
 
 private:
+  static inline const uint8_t *_find(const uint8_t *p, const uint8_t *end, uint8_t c) {
+    const uint8_t *q = (const uint8_t *)memchr(p, c, end - p);
+    return (q != NULL) ? q : end;
+  }
+
+#if DIGOLE_TEXT_BUFFER > 0
+  // Appends text (without newlines), sending the buffer whenever it fills up
+  void _writeText(const uint8_t *text, size_t length) {
+    while (length > 0) {
+      if (_text_len >= DIGOLE_TEXT_BUFFER)
+        _flushText();
+      size_t n = DIGOLE_TEXT_BUFFER - _text_len;
+      if (n > length)
+        n = length;
+      memcpy(_text + 2 + _text_len, text, n);
+      _text_len += n;
+      text += n;
+      length -= n;
+    }
+  }
+
+  void _flushText() {
+    _text[2 + _text_len] = '\x0d';
+    _count((static_cast<COM*>(this))->_writeRaw(_text, _text_len + 3));
+    _text_len = 0;
+  }
+#else
+  // Sends text (without newlines) right away, as a TT command
+  void _writeText(const uint8_t *text, size_t length) {
+    writeRaw("TT", 2);
+    writeRaw(text, length);
+    writeRaw('\x0d');
+  }
+#endif
+
+  inline void _count(size_t n) {
+#if DIGOLE_ENABLE_STATS
+    _bytes_written += n;
+#else
+    (void)n;
+#endif
+  }
+
+#if DIGOLE_ENABLE_INTERACTIVE
+  inline bool _slicing() const {
+    return _interactive != NULL && !_in_interactive;
+  }
+
+  inline uint16_t _sliceSize() const { return _bulk_slice; }
+
+  void _serviceInteractive() {
+    if (!_slicing())
+      return;
+    _in_interactive = true;
+    _interactive(_interactive_ctx);
+    _in_interactive = false;
+  }
+#else
+  inline bool _slicing() const { return false; }
+  inline uint16_t _sliceSize() const { return DIGOLE_BULK_SLICE; }
+  inline void _serviceInteractive() { }
+#endif
+
+  void _drawBitmapHeader(bitmap_t type,
+                         uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    _CMDBUF(hdr, 13, 'E', 'D', 'I', 'M', 'n', 'x', 'x', 'y', 'y', 'w', 'w', 'h', 'h');
+    uint8_t *p = 0;
+    switch (type) {
+    case BITMAP_8:
+      memcpy(hdr, "DIM", 3);
+      p = hdr + 3;
+      break;
+    case BITMAP_256:
+      hdr[4] = '1';
+      p = hdr + 5;
+      break;
+    case BITMAP_262K:
+      hdr[4] = '3';
+      p = hdr + 5;
+      break;
+    default:
+      assert(false);
+      // Should not happen!
+    } 
+    p += copyRawInt(p, x);
+    p += copyRawInt(p, y);
+    p += copyRawInt(p, w);
+    p += copyRawInt(p, h);
+    writeRaw(hdr, p - hdr);
+  }
+
+  // Copies PROGMEM data out in chunks of the backend's TRANSFER_SIZE (or,
+  // if not reentrant, of the shared scratch buffer), rather than a byte
+  // (and, on I2C, a transaction) at a time
+  void _writeProgmem(const uint8_t *data, uint32_t length) {
+#if defined(REENTRANT) && REENTRANT
+    const uint16_t CHUNK = COM::TRANSFER_SIZE;
+#else
+    const uint16_t CHUNK = DIGOLE_SCRATCH_SIZE;
+#endif
+    _SCRATCH(chunk, CHUNK);
+    while (length > 0) {
+      uint16_t n = (length > CHUNK) ? CHUNK : (uint16_t)length;
+      memcpy_P(chunk, data, n);
+      writeRaw(chunk, n);
+      data += n;
+      length -= n;
+    }
+  }
+
+  bool _after_cr;
+#if DIGOLE_TEXT_BUFFER > 0
+  uint8_t _text[DIGOLE_TEXT_BUFFER + 3];  // "TT" + text + '\r'
+  uint8_t _text_len;
+#endif
+
+#if DIGOLE_ENABLE_INTERACTIVE
+  void (*_interactive)(void *);
+  void *_interactive_ctx;
+  uint16_t _bulk_slice;
+  bool _in_interactive;
+#endif
+
+#if DIGOLE_ENABLE_STATS
+  uint32_t _bytes_written;
+#endif
 };
 
 
@@ -654,38 +853,61 @@ private:
 class DigoleSerial : public DigoleDisplay<DigoleSerial> {
 public:
   const static uint16_t RESET_PULSE = 100;   // in ms; how long to hold low
-  const static uint16_t RESET_DELAY = 1000;  // in ms; how long to wait afterwards
+  const static uint16_t RESET_DELAY = 1000;  // in ms; max wait for display to come up
+  const static uint16_t BAUD_DELAY = 100;    // in ms; max wait after a baud switch
+  const static uint16_t PROBE_WAIT = 20;     // in ms; how long to wait for each probe reply
+  const static uint16_t BAUD_SETTLE = 20;    // in ms; before probing at a new baud rate
 
   DigoleSerial(HardwareSerial &serial, unsigned long baud = 115200, uint8_t reset_pin = 0xff) :
     _serial(serial), _baud(baud), _reset_pin(reset_pin) { }
 
+  // Instead of sleeping for fixed periods, the display is probed until it
+  // answers, so begin() returns as soon as the panel is actually ready.
+  // Displays that don't answer probes just fall back to the full delays.
   void begin() {
     if (_reset_pin != 0xff) {
        pinMode(_reset_pin, OUTPUT);
        ::digitalWrite(_reset_pin, LOW);
        delay(RESET_PULSE);
        ::digitalWrite(_reset_pin, HIGH);
-       delay(RESET_DELAY);
-    }
-    _serial.begin(9600);
-#if defined(ESP8266)
-    if (_reset_pin == 0xff) {
-      _serial.setDebugOutput(0);
-      _serial.println();  // Try to make display recover from ESP boot msgs
-      delay(100);
+       _serial.begin(9600);
+       waitReady(RESET_DELAY);
+    } else {
+      _serial.begin(9600);
+      _recoverFromBootMessages();
     }
-#endif
     _serial.print("SB");
     _serial.println(_baud);
-    delay(100);
+    _serial.flush();  // Switch only after the command is out
     _serial.begin(_baud);
-#if defined(ESP8266)
-    if (_reset_pin == 0xff) {
-      _serial.setDebugOutput(0);  // paranoia, yeah!
-      _serial.println();  // why the heck not...
-      delay(100);
-    }
-#endif
+    _recoverFromBootMessages();
+    // Probes sent while the display is still at 9600 would be misread
+    // as commands
+    delay(BAUD_SETTLE);
+    waitReady(BAUD_DELAY);
+  }
+
+  // Sends a cheap round-trip command (battery read) until the display
+  // replies, or until timeout (in ms) expires.  Returns true if it replied.
+  // A slow display may still answer earlier probes after the first reply,
+  // so all replies are consumed before returning; otherwise later reads
+  // would get the answers to previous requests.
+  bool waitReady(uint16_t timeout) {
+    unsigned long start = millis();
+    uint16_t probes = 0;
+    bool ready = false;
+    _discardInput();
+    do {
+      _serial.write((const uint8_t *)"RDBAT", 5);
+      ++probes;
+      unsigned long sent = millis();
+      while (!ready && millis() - sent < PROBE_WAIT) {
+        ready = (_serial.available() >= 2);
+        yield();
+      }
+    } while (!ready && millis() - start < timeout);
+    _discardReplies(2 * probes);
+    return ready;
   }
 
 //protected:
@@ -702,6 +924,10 @@ public:
     return _serial.read();
   }
 
+  void _drain() {
+    _serial.flush();
+  }
+
   uint16_t _readInt() {
     // Note: this was forgotten in the original DigoleSerial, guessing
     uint16_t v = (uint16_t)_read() << 8;
@@ -710,6 +936,36 @@ public:
   }
 
 private:
+  void _discardInput() {
+    while (_serial.available())
+      _serial.read();
+  }
+
+  // Reads and drops up to length bytes, stopping early once the line has
+  // been quiet for longer than probes are apart (i.e., some were lost)
+  void _discardReplies(uint16_t length) {
+    unsigned long last = millis();
+    while (length > 0 && millis() - last < 2 * PROBE_WAIT) {
+      if (_serial.available()) {
+        _serial.read();
+        --length;
+        last = millis();
+      } else {
+        yield();
+      }
+    }
+    _discardInput();
+  }
+
+  inline void _recoverFromBootMessages() {
+#if defined(ESP8266)
+    if (_reset_pin == 0xff) {
+      _serial.setDebugOutput(0);
+      _serial.println();  // Try to make display recover from ESP boot msgs
+    }
+#endif
+  }
+
   HardwareSerial &_serial;
   unsigned long _baud;
   uint8_t _reset_pin;
@@ -720,8 +976,25 @@ private:
 
 #if defined(DIGOLE_I2C) && DIGOLE_I2C
 
+#if !defined(DIGOLE_I2C_CHUNK)
+#  if defined(BUFFER_LENGTH)
+#    define DIGOLE_I2C_CHUNK BUFFER_LENGTH
+#  elif defined(I2C_BUFFER_LENGTH)
+#    define DIGOLE_I2C_CHUNK I2C_BUFFER_LENGTH
+#  else
+#    define DIGOLE_I2C_CHUNK 32
+#  endif
+#endif
+
 class DigoleI2C : public DigoleDisplay<DigoleI2C> {
 public:
+  const static uint16_t I2C_CHUNK = DIGOLE_I2C_CHUNK;  // max bytes per transaction
+  const static uint16_t TRANSFER_SIZE = I2C_CHUNK;
+  const static uint8_t I2C_RETRIES = 4;      // on address NACK (display busy)
+  const static uint16_t I2C_BACKOFF = 100;   // in us; doubled on every retry
+
+  static_assert(DIGOLE_I2C_CHUNK > 0, "DIGOLE_I2C_CHUNK must be at least 1");
+
   DigoleI2C(TwoWire &wire, uint8_t i2c_addr = 0x27, unsigned long clock = 50000)
     : _wire(wire), _i2c_addr(i2c_addr), _clock(clock) { }
 
@@ -738,7 +1011,7 @@ public:
 #endif
 
   void setI2CAddress (uint8_t i2c_addr) {
-    _STATICBUF uint8_t cmd[6] = { 'S', 'I', '2', 'C', 'A', 'x' };
+    _CMDBUF(cmd, 6, 'S', 'I', '2', 'C', 'A', 'x');
     cmd[5] = i2c_addr;
     writeRaw(cmd, 6);
     _i2c_addr = i2c_addr;
@@ -747,41 +1020,27 @@ public:
 
 //protected:
   size_t _writeRaw (uint8_t c) {
-    _wire.beginTransmission(_i2c_addr);
-    _wire.write(c);
-    uint8_t status = _wire.endTransmission();
-    return (status == 0) ? 1 : 0;
+    return (_transmit(&c, 1) == 0) ? 1 : 0;
   }
 
+  // Wire silently truncates anything beyond its internal buffer, so larger
+  // writes are split into full-size segments.  Each call normally carries a
+  // whole command (or a payload following one), so short commands always go
+  // out in a single transaction, and nothing is held back between calls.
+  // Returns the number of bytes in segments that were fully acknowledged.
   size_t _writeRaw (const uint8_t *buffer, size_t size) {
-#if 0  // Alternative, less efficient(?) implementation
-    for (size_t i = 0;  i < size;  i++)
-      _writeRaw(buffer[i]);
-    return size;
-#endif
-
-#if 1
-    _wire.beginTransmission(_i2c_addr);
-    _wire.write(buffer, size);
-    uint8_t status = _wire.endTransmission();
-    return (status == 0) ? size : 0;
-#endif
-
-#if 0  // TODO FIXME - Dumps core
-    size_t remain = size;
-    while (remain > 0) {
-      _wire.beginTransmission(_i2c_addr);
-      _wire.write(buffer, min(remain, BUFFER_LENGTH));
-      uint8_t status = _wire.endTransmission();
-      if (status == 0)
-        return size - remain;  // Caveat: if status == 3, some bytes from current chunk may actually have been transmitted, but we can't know how many
-      remain -= BUFFER_LENGTH;
-      buffer += BUFFER_LENGTH;
+    size_t done = 0;
+    while (done < size) {
+      uint16_t n = (size - done > I2C_CHUNK) ? I2C_CHUNK : (uint16_t)(size - done);
+      if (_transmit(buffer + done, n) != 0)
+        break;  // Caveat: on data NACK some bytes of this segment may have gone out; we can't know how many
+      done += n;
     }
-    return size;
-#endif
+    return done;
   }
 
+  void _drain() { }  // Writes are synchronous
+
   uint8_t _read() {
     if (_wire.requestFrom(_i2c_addr, (uint8_t)1) != 1) {
       Serial.println("_read fail!"); Serial.flush();  // DEBUG
@@ -804,6 +1063,22 @@ public:
   }
 
 private:
+  // Returns Wire's endTransmission() status.  Only address NACKs are retried:
+  // nothing was accepted in that case, whereas retrying a data NACK could
+  // duplicate bytes the display already consumed.
+  uint8_t _transmit (const uint8_t *buffer, uint16_t size) {
+    uint16_t backoff = I2C_BACKOFF;
+    for (uint8_t attempt = 0;  ;  attempt++) {
+      _wire.beginTransmission(_i2c_addr);
+      _wire.write(buffer, size);
+      uint8_t status = _wire.endTransmission();
+      if (status != 2 || attempt >= I2C_RETRIES)
+        return status;
+      delayMicroseconds(backoff);
+      backoff *= 2;
+    }
+  }
+
   TwoWire &_wire;
   uint8_t _i2c_addr;
   unsigned long _clock;
@@ -812,9 +1087,11 @@ private:
 #endif  // DIGOLE_I2C
 
 #if defined(DIGOLE_SPI) && DIGOLE_SPI
-class DigoleSoftSPI : public DigoleDisplay<DigoleSoftSPI> {
+// Bit-banged SPI with pins chosen at runtime; slow (uses shiftOut/shiftIn),
+// prefer the DigoleSoftSPI template below when pins are known at compile time
+class DigoleSoftSPIRuntime : public DigoleDisplay<DigoleSoftSPIRuntime> {
 public:
-  DigoleSoftSPI(uint8_t ss, uint8_t mosi, uint8_t miso, uint8_t clk) :
+  DigoleSoftSPIRuntime(uint8_t ss, uint8_t mosi, uint8_t miso, uint8_t clk) :
     _clk_pin(clk), _miso_pin(miso), _ss_pin(ss), _mosi_pin(mosi) { }
 
   void begin() {
@@ -843,6 +1120,8 @@ public:
     return size;
   }
 
+  void _drain() { }  // Writes are synchronous
+
   uint8_t _read() {
     while (digitalRead(_mosi_pin) == LOW) yield();
     ::digitalWrite(_ss_pin, LOW);
@@ -863,8 +1142,155 @@ private:
   uint8_t _clk_pin, _miso_pin, _ss_pin, _mosi_pin;
 };
 
+
+// Direct port access for a pin fixed at compile time.
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || \
+    defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+// Uno/Nano/Pro Mini pin map; constant addresses compile to sbi/cbi/sbic
+template <uint8_t PIN>
+struct FastPin {
+  static_assert(PIN < 20, "Pin not on PORTB/C/D");
+  static const uint8_t MASK = 1 << ((PIN < 8) ? PIN : (PIN < 14) ? PIN - 8 : PIN - 14);
+
+  static inline void begin(uint8_t mode) { pinMode(PIN, mode); }
+  static inline void high() { out() |= MASK; }
+  static inline void low() { out() &= ~MASK; }
+  static inline bool read() { return (in() & MASK) != 0; }
+
+  static inline volatile uint8_t &out() {
+    return (PIN < 8) ? PORTD : (PIN < 14) ? PORTB : PORTC;
+  }
+  static inline volatile uint8_t &in() {
+    return (PIN < 8) ? PIND : (PIN < 14) ? PINB : PINC;
+  }
+};
+#elif defined(__AVR__)
+// Other AVRs: look up the port once in begin(); ports are core-specific
+template <uint8_t PIN>
+struct FastPin {
+  static inline void begin(uint8_t mode) {
+    pinMode(PIN, mode);
+    _mask = digitalPinToBitMask(PIN);
+    _out = portOutputRegister(digitalPinToPort(PIN));
+    _in = portInputRegister(digitalPinToPort(PIN));
+  }
+  static inline void high() { uint8_t s = SREG; cli(); *_out |= _mask; SREG = s; }
+  static inline void low() { uint8_t s = SREG; cli(); *_out &= ~_mask; SREG = s; }
+  static inline bool read() { return (*_in & _mask) != 0; }
+
+  static volatile uint8_t *_out, *_in;
+  static uint8_t _mask;
+};
+template <uint8_t PIN> volatile uint8_t *FastPin<PIN>::_out;
+template <uint8_t PIN> volatile uint8_t *FastPin<PIN>::_in;
+template <uint8_t PIN> uint8_t FastPin<PIN>::_mask;
+#elif defined(ESP8266)
+template <uint8_t PIN>
+struct FastPin {
+  static_assert(PIN < 16, "GPIO16 is not in the GPIO register block");
+
+  static inline void begin(uint8_t mode) { pinMode(PIN, mode); }
+  static inline void high() { GPOS = (1 << PIN); }
+  static inline void low() { GPOC = (1 << PIN); }
+  static inline bool read() { return (GPI & (1 << PIN)) != 0; }
+};
+#else
+// Fallback: correct, but no faster than the runtime variant
+template <uint8_t PIN>
+struct FastPin {
+  static inline void begin(uint8_t mode) { pinMode(PIN, mode); }
+  static inline void high() { ::digitalWrite(PIN, HIGH); }
+  static inline void low() { ::digitalWrite(PIN, LOW); }
+  static inline bool read() { return digitalRead(PIN) == HIGH; }
+};
+#endif
+
+// Bit-banged SPI with pins fixed at compile time.  SS stays asserted for a
+// whole buffer.  Direct port writes clock bits at MHz rates, and Digole
+// can't keep up with back-to-back bytes (see DigoleSPI), so BYTE_GAP (in us)
+// gives it time to consume each one.  The default matches the delay that
+// DigoleSPI allows after SS; lower it only after checking on your display.
+// extras/host_test checks framing and bit order against a simulated port.
+// Note: as in DigoleSoftSPIRuntime, data is shifted out on the MISO pin and
+// replies are read from the MOSI pin.
+template <uint8_t SS_PIN, uint8_t MOSI_PIN, uint8_t MISO_PIN, uint8_t CLK_PIN, uint8_t BYTE_GAP = 8>
+class DigoleSoftSPI : public DigoleDisplay<DigoleSoftSPI<SS_PIN, MOSI_PIN, MISO_PIN, CLK_PIN, BYTE_GAP> > {
+public:
+  const static uint16_t TRANSFER_SIZE = 64;  // SS is asserted per write
+
+  void begin() {
+    FastPin<CLK_PIN>::begin(OUTPUT);
+    FastPin<MISO_PIN>::begin(OUTPUT);
+    FastPin<SS_PIN>::begin(OUTPUT);
+    FastPin<MOSI_PIN>::begin(INPUT);  // needs pulldown
+
+    FastPin<SS_PIN>::high();
+    FastPin<CLK_PIN>::low();
+    FastPin<MISO_PIN>::low();
+  }
+
+//protected:
+  size_t _writeRaw (uint8_t c) {
+    return _writeRaw(&c, 1);
+  }
+
+  size_t _writeRaw (const uint8_t *buffer, size_t size) {
+    FastPin<SS_PIN>::low();
+    delayMicroseconds(6);
+    for (size_t i = 0;  i < size;  i++) {
+      if (i > 0 && BYTE_GAP > 0)
+        delayMicroseconds(BYTE_GAP);
+      _shiftOut(buffer[i]);
+    }
+    FastPin<SS_PIN>::high();
+    return size;
+  }
+
+  void _drain() { }  // Writes are synchronous
+
+  uint8_t _read() {
+    while (!FastPin<MOSI_PIN>::read()) yield();
+    FastPin<SS_PIN>::low();
+    delayMicroseconds(10);
+    uint8_t v = _shiftIn();
+    FastPin<SS_PIN>::high();
+    return v;
+  }
+
+  uint16_t _readInt() {
+    uint16_t v = (uint16_t)_read() << 8;
+    v |= (uint16_t)_read();
+    return v;
+  }
+
+private:
+  // Same timing as shiftOut()/shiftIn(), MSB first, clock idles low
+  static inline void _shiftOut(uint8_t c) {
+    for (uint8_t mask = 0x80;  mask != 0;  mask >>= 1) {
+      if (c & mask)
+        FastPin<MISO_PIN>::high();
+      else
+        FastPin<MISO_PIN>::low();
+      FastPin<CLK_PIN>::high();
+      FastPin<CLK_PIN>::low();
+    }
+  }
+
+  static inline uint8_t _shiftIn() {
+    uint8_t v = 0;
+    for (uint8_t i = 0;  i < 8;  i++) {
+      FastPin<CLK_PIN>::high();
+      v = (v << 1) | (FastPin<MOSI_PIN>::read() ? 1 : 0);
+      FastPin<CLK_PIN>::low();
+    }
+    return v;
+  }
+};
+
 class DigoleSPI : public DigoleDisplay<DigoleSPI> {
 public:
+  const static uint16_t TRANSFER_SIZE = 64;  // SS is asserted per write
+
   DigoleSPI(uint8_t ss, uint8_t mosi) :
     _ss_pin(ss), _mosi_pin(mosi), _spi_settings(100000, MSBFIRST, SPI_MODE1) { }
 
@@ -907,6 +1333,8 @@ public:
 #endif
   }
 
+  void _drain() { }  // Writes are synchronous
+
   uint8_t _read() {
     while (digitalRead(_mosi_pin) == LOW) yield();
     ::digitalWrite(_ss_pin, LOW);
@@ -0,0 +1,112 @@
+#ifndef DigoleCharLCD_h
+#define DigoleCharLCD_h
+
+#include "Digole.h"
+
+namespace Digole {
+
+// Character LCD front end that keeps a shadow copy of what the panel shows.
+// Printing only updates the local grid; update() then sends the fewest
+// position + text commands needed to bring the panel in sync, merging
+// nearby changes on a row when resending the unchanged characters in
+// between is cheaper than repositioning.
+//
+// Print into it like any Print (e.g. grid.setPosition(0, 1);
+// grid.print(temp); grid.update();).  '\n' moves to the next row, '\r' to
+// the start of the current one; text past the end of a row is dropped.
+template <class D, uint8_t COLS, uint8_t ROWS>
+class CharGrid : public Print {
+public:
+  // Repositioning costs 4 bytes (TP + col + row) and a new text command 3
+  // (TT + '\r'), so shorter gaps are cheaper to resend
+  const static uint8_t MERGE_GAP = 7;
+
+  CharGrid(D &lcd) : _lcd(lcd), _col(0), _row(0) {
+    memset(_grid, ' ', sizeof(_grid));
+    memset(_shadow, ' ', sizeof(_shadow));
+  }
+
+#if DIGOLE_ENABLE_CHARLCD
+  // Configures the panel size and clears it
+  void begin() {
+    _lcd.setLCDSize(COLS, ROWS);
+    _lcd.clearScreen();
+    memset(_shadow, ' ', sizeof(_shadow));
+  }
+#endif
+
+  void clear() {
+    memset(_grid, ' ', sizeof(_grid));
+    _col = _row = 0;
+  }
+
+  void setPosition(uint8_t col, uint8_t row) {
+    _col = col;
+    _row = row;
+  }
+
+  inline uint8_t at(uint8_t col, uint8_t row) const {
+    return (col < COLS && row < ROWS) ? _grid[row][col] : 0;
+  }
+
+  // Forces the next update() to resend everything
+  void invalidate() {
+    memset(_shadow, 0, sizeof(_shadow));
+  }
+
+  size_t write(uint8_t c) override {
+    if (c == '\n') {
+      _col = 0;
+      ++_row;
+    } else if (c == '\r') {
+      _col = 0;
+    } else {
+      if (_col < COLS && _row < ROWS)
+        _grid[_row][_col] = c;
+      ++_col;
+    }
+    return 1;
+  }
+
+  using Print::write;
+
+  // Sends changed cells; returns the number of characters sent
+  uint16_t update() {
+    uint16_t sent = 0;
+    for (uint8_t row = 0;  row < ROWS;  row++) {
+      uint8_t col = 0;
+      while (col < COLS) {
+        // Find the next changed cell
+        while (col < COLS && _grid[row][col] == _shadow[row][col])
+          ++col;
+        if (col == COLS)
+          break;
+
+        // Extend the run while the next change is close enough
+        uint8_t start = col, end = col + 1;  // end is exclusive
+        for (uint8_t i = end;  i < COLS && i - end < MERGE_GAP;  i++) {
+          if (_grid[row][i] != _shadow[row][i])
+            end = i + 1;
+        }
+
+        _lcd.setTextPosition(start, row);
+        _lcd.write(&_grid[row][start], end - start);
+        memcpy(&_shadow[row][start], &_grid[row][start], end - start);
+        sent += end - start;
+        col = end;
+      }
+    }
+    _lcd.flush();
+    return sent;
+  }
+
+private:
+  D &_lcd;
+  uint8_t _col, _row;
+  uint8_t _grid[ROWS][COLS];    // what we want shown
+  uint8_t _shadow[ROWS][COLS];  // what the panel shows
+};
+
+} // namespace Digole
+
+#endif /* DigoleCharLCD_h */
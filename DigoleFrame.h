@@ -0,0 +1,494 @@
+#ifndef DigoleFrame_h
+#define DigoleFrame_h
+
+#include "Digole.h"
+
+namespace Digole {
+
+// Buffers one frame worth of drawing commands and, on end(), sends only
+// those that can affect the final image:
+//  - primitives entirely outside the screen (or the current draw window)
+//    are culled, and filled rectangles are clipped to it;
+//  - primitives completely covered by a later opaque command (a MODE_COPY
+//    filled rectangle or color bitmap, clearDrawWindow() or clearScreen())
+//    are dropped;
+//  - color, draw mode and draw window settings that no remaining primitive
+//    uses are dropped.
+// Text extents depend on the font, so text is never culled or dropped.
+//
+// As on the display, coordinates are relative to the current draw window.
+// Bitmaps and strings are referenced, not copied, so they must stay valid
+// until end().  If more than CAPACITY commands are recorded, the frame is
+// flushed early (everything stays correct, only less gets optimized).
+// Each recorded command takes 20 bytes of RAM on AVR.
+// The screen size is that for ROT0; setRotation() must go through the
+// Frame so that it can keep track.
+//
+// While recording, everything must go through the Frame, or it would get
+// ahead of the recorded commands.  Commands that depend on what was drawn
+// before (moveArea()) or that change how it is drawn (fonts, line patterns)
+// flush the recording first; drawLineTo() is recorded as a full line.  For
+// anything else, use raw(), which flushes and returns the display (e.g.
+// frame.raw().print(x)).
+template <class D, uint8_t CAPACITY = 12>
+class Frame {
+public:
+  Frame(D &lcd, uint16_t width, uint16_t height) :
+    _lcd(lcd), _width(width), _height(height), _rotated(false),
+    _count(0), _recording(false), _mode(MODE_COPY),
+    _at_valid(false), _at_dirty(false),
+    _wx(0), _wy(0), _ww(width), _wh(height), _sent(0), _issued(0) {
+    _clip();
+  }
+
+  // Outside begin()/end(), commands go straight to the display (but
+  // off-screen primitives are still culled)
+  void begin() { _recording = true; }
+  // Like raw(), also brings the display's graphics position up to date,
+  // in case the last position change was culled or dropped
+  void end() {
+    _flush();
+    _syncPosition();
+    _at_valid = false;
+    _recording = false;
+    _lcd.flush();
+  }
+
+  // Sends what was recorded so far (recording continues)
+  void flush() {
+    _flush();
+    _lcd.flush();
+  }
+
+  // Flushes, then gives direct access to the display
+  D &raw() {
+    _flush();
+    _syncPosition();
+    _at_valid = false;  // The graphics position may be changed behind our back
+    return _lcd;
+  }
+
+  void setRotation(orientation_t orient) {
+    _flush();
+    bool rotated = (orient == ROT90 || orient == ROT270);
+    if (rotated != _rotated) {
+      uint16_t t = _width;
+      _width = _height;
+      _height = t;
+      _rotated = rotated;
+      if (_wx == 0 && _wy == 0 && _ww == _height && _wh == _width) {
+        _ww = _width;  // No draw window set, follow the screen
+        _wh = _height;
+      }
+      _clip();
+    }
+    _lcd.setRotation(orient);
+  }
+
+  /**** Settings ****/
+
+  void setColor(uint8_t r, uint8_t g, uint8_t b) {
+    Op *op = _add(OP_COLOR);
+    op->a = r;
+    op->b = g;
+    op->c = b;
+    _commit(op);
+  }
+
+  void setColor(uint8_t color) {
+    Op *op = _add(OP_COLOR8);
+    op->a = color;
+    _commit(op);
+  }
+
+  void setColor(const Color &color, bool to_8bit = false) {
+    if (to_8bit) {
+      setColor(static_cast<uint8_t>(color));
+    } else {
+      setColor(color.r >> 2, color.g >> 2, color.b >> 2);
+    }
+  }
+
+  void setDrawMode(draw_mode_t mode) {
+    _mode = mode;
+    Op *op = _add(OP_MODE);
+    op->arg = mode;
+    _commit(op);
+  }
+
+  void setDrawWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    _wx = x;
+    _wy = y;
+    _ww = w;
+    _wh = h;
+    _clip();
+    Op *op = _add(OP_WINDOW);
+    op->a = x;
+    op->b = y;
+    op->c = w;
+    op->d = h;
+    _commit(op);
+  }
+
+  void resetDrawWindow() {
+    _wx = _wy = 0;
+    _ww = _width;
+    _wh = _height;
+    _clip();
+    _commit(_add(OP_RESET_WINDOW));
+  }
+
+  void setBackgroundColor() {
+    _flush();
+    _lcd.setBackgroundColor();
+  }
+
+  void setLinePattern(uint8_t pattern) {
+    _flush();
+    _lcd.setLinePattern(pattern);
+  }
+
+  void setFont(uint8_t font) {
+    _flush();
+    _lcd.setFont(font);
+  }
+
+  void setTextPositionOffset(uint8_t dx, uint8_t dy) {
+    _flush();
+    _lcd.setTextPositionOffset(dx, dy);
+  }
+
+  /**** Drawing ****/
+
+  void clearScreen() {
+    Op *op = _add(OP_CLEAR);
+    _setBounds(op, 0, 0, _width - 1, _height - 1);
+    op->opaque = true;
+    _commit(op);
+  }
+
+  void clearDrawWindow() {
+    Op *op = _add(OP_CLEAR_WINDOW);
+    _setBounds(op, _cx0, _cy0, _cx1, _cy1);
+    op->opaque = true;
+    _commit(op);
+  }
+
+  void drawPixel(uint16_t x, uint16_t y, uint8_t color = 1) {
+    Op *op = _addShape(OP_PIXEL, x, y, x, y);
+    if (op == NULL)
+      return;
+    op->a = x;
+    op->b = y;
+    op->arg = color;
+    _commit(op);
+  }
+
+  void drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    _at_x = x1;
+    _at_y = y1;
+    _at_valid = true;
+    Op *op = _addShape(OP_LINE, (x0 < x1) ? x0 : x1, (y0 < y1) ? y0 : y1,
+                                (x0 > x1) ? x0 : x1, (y0 > y1) ? y0 : y1);
+    if (op == NULL) {
+      _at_dirty = true;  // The display didn't move along
+      return;
+    }
+    op->a = x0;
+    op->b = y0;
+    op->c = x1;
+    op->d = y1;
+    _commit(op);
+  }
+
+  // Sent as a full line (so that it can be culled like one), since the
+  // line it continues from may have been dropped
+  void drawLineTo(uint16_t x, uint16_t y) {
+    if (_at_valid) {
+      drawLine(_at_x, _at_y, x, y);
+    } else {
+      _flush();
+      _lcd.drawLineTo(x, y);
+      _at_x = x;
+      _at_y = y;
+      _at_valid = true;
+    }
+  }
+
+  // Only sent when the display needs it; see drawLineTo()
+  void setGraphicsPosition(uint16_t x, uint16_t y) {
+    _at_x = x;
+    _at_y = y;
+    _at_valid = true;
+    _at_dirty = true;
+  }
+
+  // Note: like DigoleDisplay::drawRect(), covers x..x+w and y..y+h
+  void drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool filled = false) {
+    Op *op = _addShape(filled ? OP_FILL : OP_RECT, x, y, (int32_t)x + w, (int32_t)y + h);
+    if (op == NULL)
+      return;
+    if (filled) {
+      // Clipped to what's visible (clipping an outline would move its edges)
+      op->a = op->x0 - _wx;
+      op->b = op->y0 - _wy;
+      op->c = op->x1 - op->x0;
+      op->d = op->y1 - op->y0;
+      op->opaque = (_mode == MODE_COPY);
+    } else {
+      op->a = x;
+      op->b = y;
+      op->c = w;
+      op->d = h;
+    }
+    _commit(op);
+  }
+
+  void drawCircle(uint16_t x, uint16_t y, uint16_t r, bool filled = false) {
+    Op *op = _addShape(OP_CIRCLE, (int32_t)x - r, (int32_t)y - r, (int32_t)x + r, (int32_t)y + r);
+    if (op == NULL)
+      return;
+    op->a = x;
+    op->b = y;
+    op->c = r;
+    op->arg = filled;
+    _commit(op);
+  }
+
+  void drawBitmap(bitmap_t type, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                  const uint8_t *data) {
+    Op *op = _addShape(OP_BITMAP, x, y, (int32_t)x + w - 1, (int32_t)y + h - 1);
+    if (op == NULL)
+      return;
+    // Monochrome bitmaps may leave 0 bits untouched, so only color ones
+    // are known to cover their (visible) area
+    op->opaque = (type != BITMAP_8 && _mode == MODE_COPY);
+    op->a = x;
+    op->b = y;
+    op->c = w;
+    op->d = h;
+    op->arg = type;
+    op->ptr = data;
+    _commit(op);
+  }
+
+  // Copies pixels, so everything recorded before goes out first
+  void moveArea(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                uint8_t dx, uint8_t dy) {
+    _flush();
+    _lcd.moveArea(x0, y0, x1, y1, dx, dy);
+  }
+
+  void drawText(uint16_t x, uint16_t y, const char *text, text_position_t unit = PIXEL) {
+    Op *op = _add(OP_TEXT);
+    op->a = x;
+    op->b = y;
+    op->arg = unit;
+    op->ptr = text;
+    _commit(op);
+  }
+
+  // Commands sent to the display vs. commands issued, since construction
+  inline uint16_t commandsSent() const { return _sent; }
+  inline uint16_t commandsIssued() const { return _issued; }
+
+private:
+  enum op_t : uint8_t {
+    OP_COLOR, OP_COLOR8, OP_MODE, OP_WINDOW, OP_RESET_WINDOW,  // state
+    OP_CLEAR, OP_CLEAR_WINDOW, OP_PIXEL, OP_LINE, OP_RECT, OP_FILL,
+    OP_CIRCLE, OP_BITMAP, OP_TEXT
+  };
+
+  struct Op {
+    uint8_t kind : 4, opaque : 1, dropped : 1;
+    uint8_t arg;
+    uint16_t a, b, c, d;           // command parameters
+    int16_t x0, y0, x1, y1;        // visible bounds, in screen coordinates
+    const void *ptr;
+  };
+
+  static inline bool _isState(uint8_t kind) { return kind <= OP_RESET_WINDOW; }
+
+  // Makes the display's graphics position match ours, if lines it would
+  // have followed were culled or dropped
+  void _syncPosition() {
+    if (_at_valid && _at_dirty)
+      _lcd.setGraphicsPosition(_at_x, _at_y);
+    _at_dirty = false;
+  }
+
+  // Visible area: draw window intersected with the screen
+  void _clip() {
+    int32_t x1 = (int32_t)_wx + _ww - 1, y1 = (int32_t)_wy + _wh - 1;
+    _cx0 = _wx;
+    _cy0 = _wy;
+    _cx1 = (x1 < _width - 1) ? x1 : _width - 1;
+    _cy1 = (y1 < _height - 1) ? y1 : _height - 1;
+  }
+
+  static inline void _setBounds(Op *op, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    op->x0 = x0;
+    op->y0 = y0;
+    op->x1 = x1;
+    op->y1 = y1;
+  }
+
+  Op *_add(uint8_t kind) {
+    ++_issued;
+    Op *op = &_direct;
+    if (_recording) {
+      if (_count == CAPACITY)
+        _flush();
+      op = &_ops[_count++];
+    }
+    memset(op, 0, sizeof(Op));
+    op->kind = kind;
+    return op;
+  }
+
+  // Like _add(), for primitives with window-relative bounds x0..x1, y0..y1
+  // (inclusive); returns NULL if the primitive is not visible at all
+  Op *_addShape(uint8_t kind, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    x0 += _wx;  x1 += _wx;
+    y0 += _wy;  y1 += _wy;
+    if (x0 < _cx0) x0 = _cx0;
+    if (y0 < _cy0) y0 = _cy0;
+    if (x1 > _cx1) x1 = _cx1;
+    if (y1 > _cy1) y1 = _cy1;
+    if (x0 > x1 || y0 > y1) {
+      ++_issued;
+      return NULL;
+    }
+    Op *op = _add(kind);
+    _setBounds(op, x0, y0, x1, y1);
+    return op;
+  }
+
+  // Recorded commands wait for _flush(); others go out right away
+  inline void _commit(Op *op) {
+    if (op == &_direct)
+      _emit(*op);
+  }
+
+  static inline bool _covers(const Op &outer, const Op &inner) {
+    return outer.x0 <= inner.x0 && outer.y0 <= inner.y0 &&
+           outer.x1 >= inner.x1 && outer.y1 >= inner.y1;
+  }
+
+  void _optimize() {
+    // Drop primitives hidden by a later opaque one
+    for (uint8_t i = 0;  i < _count;  i++) {
+      Op &op = _ops[i];
+      if (_isState(op.kind) || op.kind == OP_TEXT)
+        continue;
+      for (uint8_t j = i + 1;  j < _count;  j++) {
+        if (_ops[j].opaque && _covers(_ops[j], op)) {
+          op.dropped = true;
+          if (op.kind == OP_LINE)
+            _at_dirty = true;
+          break;
+        }
+      }
+    }
+    // Drop settings overridden before any remaining command used them
+    // (clearing uses neither the color nor the mode; clearScreen() also
+    // ignores the draw window)
+    for (uint8_t i = 0;  i < _count;  i++) {
+      Op &op = _ops[i];
+      if (!_isState(op.kind))
+        continue;
+      bool window = (op.kind == OP_WINDOW || op.kind == OP_RESET_WINDOW);
+      for (uint8_t j = i + 1;  j < _count;  j++) {
+        const Op &next = _ops[j];
+        if (next.dropped)
+          continue;
+        if (!_isState(next.kind)) {
+          bool unused = window ? (next.kind == OP_CLEAR) :
+                        (next.kind == OP_CLEAR || next.kind == OP_CLEAR_WINDOW);
+          if (!unused)
+            break;
+        } else if ((next.kind == op.kind) ||
+                   (window && (next.kind == OP_WINDOW || next.kind == OP_RESET_WINDOW)) ||
+                   (next.kind == OP_COLOR && op.kind == OP_COLOR8) ||
+                   (next.kind == OP_COLOR8 && op.kind == OP_COLOR)) {
+          op.dropped = true;  // Overridden
+          break;
+        }
+      }
+    }
+  }
+
+  void _flush() {
+    _optimize();
+    for (uint8_t i = 0;  i < _count;  i++) {
+      if (!_ops[i].dropped)
+        _emit(_ops[i]);
+    }
+    _count = 0;
+  }
+
+  void _emit(const Op &op) {
+    ++_sent;
+    switch (op.kind) {
+    case OP_COLOR:
+      _lcd.setColor((uint8_t)op.a, (uint8_t)op.b, (uint8_t)op.c);
+      break;
+    case OP_COLOR8:
+      _lcd.setColor((uint8_t)op.a);
+      break;
+    case OP_MODE:
+      _lcd.setDrawMode((draw_mode_t)op.arg);
+      break;
+    case OP_WINDOW:
+      _lcd.setDrawWindow(op.a, op.b, op.c, op.d);
+      break;
+    case OP_RESET_WINDOW:
+      _lcd.resetDrawWindow();
+      break;
+    case OP_CLEAR:
+      _lcd.clearScreen();
+      break;
+    case OP_CLEAR_WINDOW:
+      _lcd.clearDrawWindow();
+      break;
+    case OP_PIXEL:
+      _lcd.drawPixel(op.a, op.b, op.arg);
+      break;
+    case OP_LINE:
+      _lcd.drawLine(op.a, op.b, op.c, op.d);
+      break;
+    case OP_RECT:
+    case OP_FILL:
+      _lcd.drawRect(op.a, op.b, op.c, op.d, op.kind == OP_FILL);
+      break;
+    case OP_CIRCLE:
+      _lcd.drawCircle(op.a, op.b, op.c, op.arg);
+      break;
+    case OP_BITMAP:
+      _lcd.drawBitmap((bitmap_t)op.arg, op.a, op.b, op.c, op.d, (const uint8_t *)op.ptr);
+      break;
+    case OP_TEXT:
+      _lcd.setTextPosition(op.a, op.b, (text_position_t)op.arg);
+      _lcd.print((const char *)op.ptr);
+      break;
+    }
+  }
+
+  D &_lcd;
+  uint16_t _width, _height;
+  bool _rotated;
+  uint8_t _count;
+  bool _recording;
+  draw_mode_t _mode;
+  bool _at_valid, _at_dirty;        // graphics position known / not on the display
+  uint16_t _at_x, _at_y;
+  uint16_t _wx, _wy, _ww, _wh;      // draw window
+  int16_t _cx0, _cy0, _cx1, _cy1;   // visible area, in screen coordinates
+  uint16_t _sent, _issued;
+  Op _direct;                       // scratch entry when not recording
+  Op _ops[CAPACITY];
+};
+
+} // namespace Digole
+
+#endif /* DigoleFrame_h */
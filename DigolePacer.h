@@ -0,0 +1,112 @@
+#ifndef DigolePacer_h
+#define DigolePacer_h
+
+#include "Digole.h"
+
+namespace Digole {
+
+// Paces redraws to a target frame rate, and to what the bus can actually
+// carry.  Instead of drawing on every state change, call invalidate() when
+// something changes and draw only when frameDue() says so:
+//
+//   sensor.read(&state);  pacer.invalidate();
+//   if (pacer.frameDue()) {
+//     pacer.beginFrame();  render(state);  pacer.endFrame();
+//   }
+//
+// Changes made while a frame is pending are merged into it, so the next
+// frame always shows the newest state rather than working through a
+// backlog.  endFrame() waits until the frame has actually gone out, and if
+// that took longer than the frame period, the next frame is pushed back
+// accordingly (i.e., the effective rate drops to what the link sustains).
+// Pacing relies only on how long that blocking drain() takes; throughput()
+// is reported for monitoring, and doesn't affect when frames are due.
+template <class D>
+class FramePacer {
+public:
+  FramePacer(D &lcd, uint8_t fps = 30) :
+    _lcd(lcd), _next(0), _changed(0), _start(0), _shown(0), _start_bytes(0),
+    _pending(false), _merged(0), _frames(0), _dropped(0),
+    _latency(0), _max_latency(0), _throughput(0) {
+    setTargetFPS(fps);
+  }
+
+  void setTargetFPS(uint8_t fps) {
+    _period = (fps > 0) ? 1000 / fps : 0;
+  }
+
+  // Marks the display contents as stale
+  void invalidate() {
+    if (_pending) {
+      ++_merged;
+    } else {
+      _pending = true;
+      _changed = millis();
+    }
+  }
+
+  bool frameDue() const {
+    return _pending && (long)(millis() - _next) >= 0;
+  }
+
+  void beginFrame() {
+    _start = millis();
+    // Changes from here on belong to the next frame
+    _shown = _pending ? _changed : _start;
+#if DIGOLE_ENABLE_STATS
+    _start_bytes = _lcd.bytesWritten();
+#endif
+    _pending = false;
+    _dropped += _merged;
+    _merged = 0;
+  }
+
+  void endFrame() {
+    _lcd.drain();
+    unsigned long now = millis();
+    unsigned long elapsed = now - _start;
+
+    _next = _start + ((elapsed > _period) ? elapsed : _period);
+    _latency = now - _shown;
+    if (_latency > _max_latency)
+      _max_latency = _latency;
+#if DIGOLE_ENABLE_STATS
+    if (elapsed > 0) {
+      uint32_t bytes = _lcd.bytesWritten() - _start_bytes;
+      uint32_t rate = bytes * 1000 / elapsed;
+      // Moving average, weight 1/4
+      _throughput = (_throughput == 0) ? rate : (3 * _throughput + rate) / 4;
+    }
+#endif
+    ++_frames;
+  }
+
+  inline uint32_t frames() const { return _frames; }
+  // State changes that were merged into a later frame
+  inline uint32_t droppedFrames() const { return _dropped + _merged; }
+  // From the first change a frame shows to the end of its transfer, in ms
+  inline uint16_t latency() const { return _latency; }
+  inline uint16_t maxLatency() const { return _max_latency; }
+  // Measured bus throughput, in bytes/s (0 until measurable, or without
+  // DIGOLE_ENABLE_STATS)
+  inline uint32_t throughput() const { return _throughput; }
+
+  void resetStats() {
+    _frames = _dropped = _merged = 0;
+    _max_latency = 0;
+  }
+
+private:
+  D &_lcd;
+  uint16_t _period;  // in ms
+  unsigned long _next, _changed, _start, _shown;
+  uint32_t _start_bytes;
+  bool _pending;
+  uint32_t _merged, _frames, _dropped;
+  uint16_t _latency, _max_latency;
+  uint32_t _throughput;
+};
+
+} // namespace Digole
+
+#endif /* DigolePacer_h */
@@ -0,0 +1,176 @@
+#ifndef DigoleProvision_h
+#define DigoleProvision_h
+
+#include "Digole.h"
+
+namespace Digole {
+
+#if DIGOLE_ENABLE_FLASH
+
+enum asset_kind_t : uint8_t {
+  ASSET_START_SCREEN,  // uploaded with uploadStartScreen()
+  ASSET_USER_FONT,     // uploaded with uploadUserFont(), into section
+  ASSET_FLASH_FONT     // written to flash at address, used via setFlashFont()
+};
+
+// An asset the display should hold.  Data is in PROGMEM.  slot picks the
+// asset's hash record in the provisioner's record sector; each asset needs
+// its own.  A flash font must start on a sector boundary, and owns every
+// sector it touches (flash can only be erased a whole sector at a time).
+struct Asset {
+  asset_kind_t kind;
+  const uint8_t *data;
+  uint32_t length;
+  uint16_t version;
+  uint8_t slot;
+  uint32_t address;  // ASSET_FLASH_FONT only
+  uint8_t section;   // ASSET_USER_FONT only
+};
+
+// Keeps fonts and the start screen on the display up to date without
+// uploading them on every boot.  For each asset, a record in display flash
+// holds the version and content hash it was last provisioned with;
+// provision() reads back just that record and uploads only if it differs.
+// The records of up to SLOTS assets share the flash sector at RECORDS,
+// which must hold nothing else:
+//
+//   const Digole::Asset ASSETS[] = {
+//     { Digole::ASSET_START_SCREEN, logo, sizeof(logo), 1, 0 },
+//     { Digole::ASSET_FLASH_FONT, font, sizeof(font), 1, 1, 0x10000 },
+//   };
+//   Digole::Provisioner<DigoleSerial, 0x7F000> provisioner(LCD);
+//   provisioner.provision(ASSETS, 2);
+//   provisioner.useFont(ASSETS[1]);
+//
+// The record is invalidated before uploading and written back only once
+// the upload is done, so an interrupted upload is retried on the next boot.
+// Invalidating rewrites the whole sector; if that is interrupted, the
+// other assets are just uploaded again too.
+template <class D, uint32_t RECORDS, uint8_t SLOTS = 4>
+class Provisioner {
+public:
+  const static uint16_t MAGIC = 0xD16A;
+  const static uint8_t RECORD_SIZE = 12;  // magic, version, hash, length
+  const static uint16_t SECTOR_SIZE = 4096;  // flash erase granularity
+
+  static_assert(RECORDS % SECTOR_SIZE == 0, "RECORDS must start a flash sector");
+  static_assert(SLOTS > 0 && SLOTS * RECORD_SIZE <= 1024,
+                "Records must fit in one flashWriteBuffer()");
+
+  Provisioner(D &lcd) : _lcd(lcd) { }
+
+  // FNV-1a over PROGMEM data
+  static uint32_t hash(const uint8_t *data, uint32_t length) {
+    uint32_t h = 2166136261UL;
+    for (uint32_t i = 0;  i < length;  i++) {
+      h ^= pgm_read_byte_near(data + i);
+      h *= 16777619UL;
+    }
+    return h;
+  }
+
+  // Whether the display already holds this version of the asset
+  bool current(const Asset &asset) {
+    uint8_t stored[RECORD_SIZE], expected[RECORD_SIZE];
+    _lcd.flashRead(stored, _address(asset.slot), RECORD_SIZE);
+    _record(expected, asset);
+    return memcmp(stored, expected, RECORD_SIZE) == 0;
+  }
+
+  // Whether provision() can upload the asset in this configuration
+  static bool supported(const Asset &asset) {
+    if (asset.slot >= SLOTS)
+      return false;
+    switch (asset.kind) {
+#if DIGOLE_ENABLE_UPLOAD
+    case ASSET_START_SCREEN:
+    case ASSET_USER_FONT:
+      return asset.length <= 0xffff;  // Upload commands take 16-bit lengths
+#endif  // DIGOLE_ENABLE_UPLOAD
+    case ASSET_FLASH_FONT:
+      // Erasing the font must not take anything else with it
+      return asset.address % SECTOR_SIZE == 0 &&
+        !(RECORDS >= asset.address && RECORDS < asset.address + asset.length);
+    default:
+      return false;
+    }
+  }
+
+  // Uploads the asset if needed; returns true if it was uploaded.
+  // Unsupported assets (see supported()) are left alone.
+  bool provision(const Asset &asset) {
+    if (!supported(asset) || current(asset))
+      return false;
+
+    _invalidate(asset.slot);
+    switch (asset.kind) {
+#if DIGOLE_ENABLE_UPLOAD
+    case ASSET_START_SCREEN:
+      _lcd.uploadStartScreen(asset.data, (uint16_t)asset.length);
+      break;
+    case ASSET_USER_FONT:
+      _lcd.uploadUserFont(asset.section, asset.data, (uint16_t)asset.length);
+      break;
+#endif  // DIGOLE_ENABLE_UPLOAD
+    default:  // ASSET_FLASH_FONT
+      _lcd.flashErase(asset.address, asset.length);
+      _lcd.flashWrite(asset.address, asset.data, asset.length);
+      break;
+    }
+
+    // The slot was left erased, so it can be written without erasing
+    uint8_t record[RECORD_SIZE];
+    _record(record, asset);
+    _lcd.flashWriteBuffer(_address(asset.slot), record, RECORD_SIZE);
+    return true;
+  }
+
+  // Returns the number of assets uploaded
+  uint8_t provision(const Asset *assets, uint8_t count) {
+    uint8_t uploaded = 0;
+    for (uint8_t i = 0;  i < count;  i++) {
+      if (provision(assets[i]))
+        ++uploaded;
+    }
+    return uploaded;
+  }
+
+  // Selects a provisioned ASSET_FLASH_FONT as the current font
+  void useFont(const Asset &asset) {
+    _lcd.setFlashFont(asset.address);
+  }
+
+private:
+  static uint32_t _address(uint8_t slot) {
+    return RECORDS + (uint32_t)slot * RECORD_SIZE;
+  }
+
+  // Erases the record sector, and writes back all records but this one
+  void _invalidate(uint8_t slot) {
+    uint8_t records[SLOTS * RECORD_SIZE];
+    _lcd.flashRead(records, RECORDS, sizeof(records));
+    memset(records + slot * RECORD_SIZE, 0xff, RECORD_SIZE);
+    _lcd.flashErase(RECORDS, SECTOR_SIZE);
+    _lcd.flashWriteBuffer(RECORDS, records, sizeof(records));
+  }
+
+  static void _record(uint8_t *dest, const Asset &asset) {
+    uint32_t h = hash(asset.data, asset.length);
+    dest[0] = (uint8_t)(MAGIC >> 8);
+    dest[1] = (uint8_t)(MAGIC & 0xff);
+    dest[2] = (uint8_t)(asset.version >> 8);
+    dest[3] = (uint8_t)(asset.version & 0xff);
+    for (uint8_t i = 0;  i < 4;  i++) {
+      dest[4 + i] = (uint8_t)(h >> (24 - 8 * i));
+      dest[8 + i] = (uint8_t)(asset.length >> (24 - 8 * i));
+    }
+  }
+
+  D &_lcd;
+};
+
+#endif  // DIGOLE_ENABLE_FLASH
+
+} // namespace Digole
+
+#endif /* DigoleProvision_h */
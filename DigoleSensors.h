@@ -0,0 +1,147 @@
+#ifndef DigoleSensors_h
+#define DigoleSensors_h
+
+#include "Digole.h"
+
+namespace Digole {
+
+enum sensor_t : uint8_t {
+  SENSOR_BATTERY = 0x01,
+  SENSOR_AUX = 0x02,
+  SENSOR_TEMPERATURE = 0x04,
+  SENSOR_ALL = 0x07
+};
+
+// Polls battery, aux and temperature readings on a fixed schedule and
+// serves them from a cache, so render loops don't pay a blocking round-trip
+// per widget refresh.  Call poll() from loop(); it only talks to the display
+// when the interval has elapsed.
+//
+// With pipelining enabled, all requests go out in a single write and the
+// replies are collected afterwards (one bus turnaround instead of three).
+// Some I2C backpacks only keep the latest reply around, and answer the
+// others with 0xffff (which is also what DigoleI2C returns when a read
+// fails).  Such samples are discarded, keeping the previous reading; if a
+// channel never gets a reading, disable pipelining.
+//
+// WINDOW > 1 enables a moving-average filter over the last WINDOW samples.
+template <class D, uint8_t WINDOW = 1>
+class SensorSampler {
+  static_assert(WINDOW > 0, "WINDOW must be at least 1");
+
+public:
+  SensorSampler(D &display, uint16_t interval = 1000,
+                uint8_t channels = SENSOR_ALL, bool pipelined = true) :
+    _display(display), _interval(interval), _channels(channels & SENSOR_ALL),
+    _pipelined(pipelined), _sampled(false), _timestamp(0) {
+    for (uint8_t i = 0;  i < NUM_CHANNELS;  i++)
+      _reset(i);
+  }
+
+  void setInterval(uint16_t interval) { _interval = interval; }
+  // Newly enabled channels start over, rather than averaging in stale samples
+  void setChannels(uint8_t channels) {
+    channels &= SENSOR_ALL;
+    for (uint8_t i = 0;  i < NUM_CHANNELS;  i++) {
+      if ((channels & (1 << i)) && !(_channels & (1 << i)))
+        _reset(i);
+    }
+    _channels = channels;
+  }
+  void setPipelined(bool pipelined) { _pipelined = pipelined; }
+
+  // Samples if the interval has elapsed (or nothing was sampled yet).
+  // Returns true if new readings were taken.
+  bool poll() {
+    if (_sampled && (millis() - _timestamp) < _interval)
+      return false;
+    sample();
+    return true;
+  }
+
+  // Samples unconditionally
+  void sample() {
+    static const uint8_t cmds[NUM_CHANNELS][5] PROGMEM = {
+      { 'R', 'D', 'B', 'A', 'T' },
+      { 'R', 'D', 'A', 'U', 'X' },
+      { 'R', 'D', 'T', 'M', 'P' }
+    };
+    uint16_t v[NUM_CHANNELS];
+
+    _SCRATCH(buf, 5 * NUM_CHANNELS);
+    if (_pipelined) {
+      uint8_t *p = buf;
+      for (uint8_t i = 0;  i < NUM_CHANNELS;  i++) {
+        if (_channels & (1 << i)) {
+          memcpy_P(p, cmds[i], 5);
+          p += 5;
+        }
+      }
+      _display.writeRaw(buf, p - buf);
+      for (uint8_t i = 0;  i < NUM_CHANNELS;  i++) {
+        if (_channels & (1 << i))
+          v[i] = _display.readInt();
+      }
+    } else {
+      for (uint8_t i = 0;  i < NUM_CHANNELS;  i++) {
+        if (_channels & (1 << i)) {
+          memcpy_P(buf, cmds[i], 5);
+          _display.writeRaw(buf, 5);
+          v[i] = _display.readInt();
+        }
+      }
+    }
+
+    for (uint8_t i = 0;  i < NUM_CHANNELS;  i++) {
+      if (!(_channels & (1 << i)) || v[i] == 0xffff)
+        continue;  // Not sampled, or the read failed
+      _sums[i] -= _samples[i][_pos[i]];
+      _samples[i][_pos[i]] = v[i];
+      _sums[i] += v[i];
+      _pos[i] = (_pos[i] + 1) % WINDOW;
+      if (_count[i] < WINDOW)
+        ++_count[i];
+    }
+    _sampled = true;
+    _timestamp = millis();
+  }
+
+  // Cached (filtered) reading for a single channel; 0 until first sample
+  uint16_t value(sensor_t channel) const {
+    uint8_t i = (channel == SENSOR_BATTERY) ? 0 : (channel == SENSOR_AUX) ? 1 : 2;
+    if (_count[i] == 0)
+      return 0;
+    return (uint16_t)(_sums[i] / _count[i]);
+  }
+
+  uint16_t battery() const { return value(SENSOR_BATTERY); }
+  uint16_t aux() const { return value(SENSOR_AUX); }
+  uint16_t temperature() const { return value(SENSOR_TEMPERATURE); }
+
+  // Whether any channel has a reading yet
+  bool valid() const { return _count[0] > 0 || _count[1] > 0 || _count[2] > 0; }
+  unsigned long timestamp() const { return _timestamp; }  // millis() of last sample
+  unsigned long age() const { return millis() - _timestamp; }
+
+private:
+  static const uint8_t NUM_CHANNELS = 3;
+
+  void _reset(uint8_t i) {
+    memset(_samples[i], 0, sizeof(_samples[i]));
+    _sums[i] = 0;
+    _pos[i] = _count[i] = 0;
+  }
+
+  D &_display;
+  uint16_t _interval;
+  uint8_t _channels;
+  bool _pipelined, _sampled;
+  uint8_t _pos[NUM_CHANNELS], _count[NUM_CHANNELS];
+  unsigned long _timestamp;
+  uint16_t _samples[NUM_CHANNELS][WINDOW];
+  uint32_t _sums[NUM_CHANNELS];
+};
+
+} // namespace Digole
+
+#endif /* DigoleSensors_h */
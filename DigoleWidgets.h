@@ -0,0 +1,278 @@
+#ifndef DigoleWidgets_h
+#define DigoleWidgets_h
+
+#include "Digole.h"
+
+namespace Digole {
+
+// A minimal retained-mode widget layer for targets that can't afford a
+// framebuffer.  Widgets only remember their last parameters; a Screen
+// redraws just the widgets whose state changed, erasing their bounds via a
+// draw window (so the cost of an update scales with what changed).
+//
+// Widgets are linked into their screen (no heap allocation), so they must
+// outlive it.  While a widget draws, its bounds are the current draw window,
+// hence all coordinates in draw() are relative to the widget.
+
+template <class D> class Screen;
+
+template <class D>
+class Widget {
+public:
+  Widget(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+         const Color &color = Color(0xff, 0xff, 0xff)) :
+    _x(x), _y(y), _w(w), _h(h), _color(color), _dirty(true), _next(NULL) { }
+
+  virtual ~Widget() { }
+
+  inline void invalidate() { _dirty = true; }
+  inline bool dirty() const { return _dirty; }
+
+  void setColor(const Color &color) {
+    if (color.r != _color.r || color.g != _color.g || color.b != _color.b) {
+      _color = color;
+      _dirty = true;
+    }
+  }
+
+  inline bool contains(uint16_t x, uint16_t y) const {
+    return x >= _x && y >= _y && x < _x + _w && y < _y + _h;
+  }
+
+  inline uint16_t x() const { return _x; }
+  inline uint16_t y() const { return _y; }
+  inline uint16_t width() const { return _w; }
+  inline uint16_t height() const { return _h; }
+
+protected:
+  virtual void draw(D &lcd) = 0;
+
+  // Text is drawn with its baseline a couple of pixels above the bottom edge
+  inline void _drawText(D &lcd, uint16_t x, const char *text) {
+    if (text == NULL)
+      return;
+    lcd.setTextPosition(x, (_h > 2) ? _h - 2 : 0, PIXEL);
+    lcd.print(text);
+  }
+
+  uint16_t _x, _y, _w, _h;
+  Color _color;
+  bool _dirty;
+
+private:
+  friend class Screen<D>;
+  Widget<D> *_next;
+};
+
+
+template <class D>
+class Label : public Widget<D> {
+public:
+  Label(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *text = NULL) :
+    Widget<D>(x, y, w, h), _text(text) { }
+
+  // Only the pointer is compared; if the text is modified in place,
+  // call invalidate()
+  void setText(const char *text) {
+    if (text != _text) {
+      _text = text;
+      this->_dirty = true;
+    }
+  }
+
+protected:
+  void draw(D &lcd) override {
+    this->_drawText(lcd, 0, _text);
+  }
+
+  const char *_text;
+};
+
+
+template <class D>
+class Value : public Widget<D> {
+public:
+  Value(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *suffix = NULL) :
+    Widget<D>(x, y, w, h), _value(0), _suffix(suffix) { }
+
+  void setValue(long value) {
+    if (value != _value) {
+      _value = value;
+      this->_dirty = true;
+    }
+  }
+
+  inline long value() const { return _value; }
+
+protected:
+  void draw(D &lcd) override {
+    lcd.setTextPosition(0, (this->_h > 2) ? this->_h - 2 : 0, PIXEL);
+    lcd.print(_value);
+    if (_suffix != NULL)
+      lcd.print(_suffix);
+  }
+
+  long _value;
+  const char *_suffix;
+};
+
+
+// Horizontal bar; only redrawn when the filled width (in pixels) changes
+template <class D>
+class Bar : public Widget<D> {
+public:
+  Bar(uint16_t x, uint16_t y, uint16_t w, uint16_t h, long min = 0, long max = 100) :
+    Widget<D>(x, y, w, h), _min(min), _max(max), _fill(0) { }
+
+  void setValue(long value) {
+    if (value < _min)
+      value = _min;
+    if (value > _max)
+      value = _max;
+    uint16_t fill = (_max > _min) ?
+      (uint16_t)((value - _min) * (this->_w - 2) / (_max - _min)) : 0;
+    if (fill != _fill) {
+      _fill = fill;
+      this->_dirty = true;
+    }
+  }
+
+protected:
+  void draw(D &lcd) override {
+    lcd.drawRect(0, 0, this->_w - 1, this->_h - 1);
+    if (_fill > 0)
+      lcd.drawRect(1, 1, _fill - 1, this->_h - 3, true);
+  }
+
+  long _min, _max;
+  uint16_t _fill;
+};
+
+
+// Bitmap in PROGMEM, sized to the widget's bounds
+template <class D>
+class Icon : public Widget<D> {
+public:
+  Icon(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+       const uint8_t *bitmap = NULL, bitmap_t type = BITMAP_8) :
+    Widget<D>(x, y, w, h), _bitmap(bitmap), _type(type) { }
+
+  void setBitmap(const uint8_t *bitmap, bitmap_t type = BITMAP_8) {
+    if (bitmap != _bitmap || type != _type) {
+      _bitmap = bitmap;
+      _type = type;
+      this->_dirty = true;
+    }
+  }
+
+protected:
+  void draw(D &lcd) override {
+    if (_bitmap != NULL)
+      lcd.drawBitmap(_type, 0, 0, this->_w, this->_h, _bitmap);
+  }
+
+  const uint8_t *_bitmap;
+  bitmap_t _type;
+};
+
+
+// Outlined label; drawn filled, with inverted text, while pressed
+template <class D>
+class Button : public Label<D> {
+public:
+  Button(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *text = NULL) :
+    Label<D>(x, y, w, h, text), _pressed(false) { }
+
+  void setPressed(bool pressed) {
+    if (pressed != _pressed) {
+      _pressed = pressed;
+      this->_dirty = true;
+    }
+  }
+
+  inline bool pressed() const { return _pressed; }
+
+protected:
+  void draw(D &lcd) override {
+    lcd.drawRect(0, 0, this->_w - 1, this->_h - 1, _pressed);
+    if (_pressed)
+      lcd.setDrawMode(MODE_XOR);
+    this->_drawText(lcd, 2, this->_text);
+    if (_pressed) {
+      lcd.flush();
+      lcd.setDrawMode(MODE_COPY);
+    }
+  }
+
+  bool _pressed;
+};
+
+
+template <class D>
+class Screen {
+public:
+  Screen(D &lcd) : _lcd(lcd), _first(NULL) { }
+
+  // Widgets are drawn in the order they were added
+  void add(Widget<D> &widget) {
+    widget._next = NULL;
+    widget._dirty = true;
+    Widget<D> **p = &_first;
+    while (*p != NULL)
+      p = &(*p)->_next;
+    *p = &widget;
+  }
+
+  void invalidate() {
+    for (Widget<D> *w = _first;  w != NULL;  w = w->_next)
+      w->_dirty = true;
+  }
+
+  // Redraws widgets whose state changed; returns how many were redrawn
+  uint8_t update() {
+    uint8_t count = 0;
+    for (Widget<D> *w = _first;  w != NULL;  w = w->_next) {
+      if (!w->_dirty)
+        continue;
+      _lcd.setDrawWindow(w->_x, w->_y, w->_w, w->_h);
+      _lcd.clearDrawWindow();
+      _lcd.setColor(w->_color);
+      w->draw(_lcd);
+      _lcd.resetDrawWindow();
+      w->_dirty = false;
+      ++count;
+    }
+    _lcd.flush();
+    return count;
+  }
+
+  // Topmost (last added) widget containing the point, or NULL
+  Widget<D> *hitTest(uint16_t x, uint16_t y) const {
+    Widget<D> *hit = NULL;
+    for (Widget<D> *w = _first;  w != NULL;  w = w->_next) {
+      if (w->contains(x, y))
+        hit = w;
+    }
+    return hit;
+  }
+
+#if DIGOLE_ENABLE_TOUCH
+  // Reads the touchscreen and returns the widget under the touch, or NULL
+  // if there is no touch (or it misses all widgets)
+  Widget<D> *touched(touch_mode_t mode = TOUCH_DOWN_NONBLOCKING) {
+    uint16_t x, y;
+    _lcd.readTouchscreen(x, y, mode);
+    if (x >= 0xf000 || y >= 0xf000)  // No touch; see readTouchscreen()
+      return NULL;
+    return hitTest(x, y);
+  }
+#endif  // DIGOLE_ENABLE_TOUCH
+
+private:
+  D &_lcd;
+  Widget<D> *_first;
+};
+
+} // namespace Digole
+
+#endif /* DigoleWidgets_h */
@@ -1,11 +1,54 @@
 #ifndef Digole_config_h
 #define Digole_config_h
 
+// All of these may be overridden by defining them before including Digole.h
+// (or on the compiler command line)
+
+#ifndef REENTRANT
 #define REENTRANT 1
+#endif
 
+#if !defined(DIGOLE_I2C) && !defined(DIGOLE_SERIAL) && !defined(DIGOLE_SPI)
 //#define DIGOLE_I2C  0
 #define DIGOLE_SERIAL  1
 //#define DIGOLE_SPI 0
+#endif
+
+// Size of the buffer used to coalesce printed text into single commands
+// (at most 255); 0 sends text straight through, saving the buffer's RAM
+#ifndef DIGOLE_TEXT_BUFFER
+#define DIGOLE_TEXT_BUFFER 32
+#endif
+
+// Approximate size (in bytes) of bulk transfer slices, between which
+// an interactive handler may run; see setInteractiveHandler()
+#ifndef DIGOLE_BULK_SLICE
+#define DIGOLE_BULK_SLICE 256
+#endif
+
+// Optional per-display state, which every display object pays for in RAM;
+// set to 0 to leave it out
+#ifndef DIGOLE_ENABLE_INTERACTIVE
+#define DIGOLE_ENABLE_INTERACTIVE 1  // setInteractiveHandler(), sliced bulk transfers
+#endif
+#ifndef DIGOLE_ENABLE_STATS
+#define DIGOLE_ENABLE_STATS 1        // bytesWritten() (FramePacer throughput)
+#endif
 
+// Optional command groups.  Unused methods of a template are never compiled,
+// so these cost nothing unless called; setting them to 0 only removes the
+// methods (e.g. to make sure a build doesn't pull them in)
+#ifndef DIGOLE_ENABLE_TOUCH
+#define DIGOLE_ENABLE_TOUCH 1    // touchscreen, battery/aux/temperature reads
+#endif
+#ifndef DIGOLE_ENABLE_UPLOAD
+#define DIGOLE_ENABLE_UPLOAD 1   // user font and start screen uploads
+#endif
+#ifndef DIGOLE_ENABLE_FLASH
+#define DIGOLE_ENABLE_FLASH 1    // external flash access
+#endif
+#ifndef DIGOLE_ENABLE_CHARLCD
+#define DIGOLE_ENABLE_CHARLCD 1  // character LCD chip/size, raw LCD commands
+#endif
 
 #endif /* Digole_config_h */
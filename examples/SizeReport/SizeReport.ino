@@ -0,0 +1,56 @@
+// Calls into every optional command group, so that compiling with groups
+// switched off shows what using each one costs (groups cost nothing unless
+// called).  Nothing else is guarded, so switching off the per-display
+// settings shows what every sketch pays for them.  See extras/size_report.sh
+
+#if defined(DIGOLE_I2C) && DIGOLE_I2C
+#include <Wire.h>
+#endif
+#if defined(DIGOLE_SPI) && DIGOLE_SPI
+#include <SPI.h>
+#endif
+
+#include <Digole.h>
+
+#if defined(DIGOLE_I2C) && DIGOLE_I2C
+Digole::DigoleI2C LCD(Wire);
+#elif defined(DIGOLE_SPI) && DIGOLE_SPI
+Digole::DigoleSPI LCD(10, 12);
+#else
+Digole::DigoleSerial LCD(Serial, 115200);
+#endif
+
+const uint8_t data[8] PROGMEM = { 0 };
+
+void setup() {
+  LCD.begin();
+  LCD.clearScreen();
+  LCD.setColor(0xff, 0xff, 0xff);
+  LCD.drawRect(0, 0, 10, 10, true);
+  LCD.print("Hello");
+#if DIGOLE_ENABLE_TOUCH
+  uint16_t x, y;
+  LCD.readTouchscreen(x, y, Digole::TOUCH_DOWN_NONBLOCKING);
+  LCD.drawPixel(x, y);
+  LCD.drawPixel(LCD.readBattery(), LCD.readTemperature());
+#endif
+#if DIGOLE_ENABLE_UPLOAD
+  LCD.uploadUserFont(0, data, sizeof(data));
+  LCD.uploadStartScreen(data, sizeof(data));
+#endif
+#if DIGOLE_ENABLE_FLASH
+  uint8_t buf[sizeof(data)];
+  LCD.flashErase(0, sizeof(data));
+  LCD.flashWrite(0, data, sizeof(data));
+  LCD.flashRead(buf, 0, sizeof(buf));
+  LCD.setFlashFont(0);
+#endif
+#if DIGOLE_ENABLE_CHARLCD
+  LCD.setLCDChip(Digole::CHIP_ST7920);
+  LCD.setLCDSize(20, 4);
+  LCD.sendRawCommand(0x01);
+#endif
+}
+
+void loop() {
+}
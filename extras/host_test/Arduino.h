@@ -0,0 +1,45 @@
+// Just enough of the Arduino core to build Digole.h on the host.  The GPIO
+// and timing functions are provided by each program, which can also derive
+// simulated ports from HardwareSerial (here, TwoWire and SPIClass).
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Print.h"
+
+#define PROGMEM
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define MSBFIRST 1
+
+inline void memcpy_P(void *dest, const void *src, size_t n) { memcpy(dest, src, n); }
+inline uint8_t pgm_read_byte_near(const uint8_t *p) { return *p; }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void shiftOut(uint8_t data_pin, uint8_t clock_pin, uint8_t order, uint8_t value);
+uint8_t shiftIn(uint8_t data_pin, uint8_t clock_pin, uint8_t order);
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long) { }
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  size_t write(uint8_t) override { return 1; }
+  using Print::write;
+  void flush() override { }
+  operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+#endif
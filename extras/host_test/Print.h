@@ -0,0 +1,43 @@
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+class Print {
+public:
+  virtual ~Print() { }
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--)
+      n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+  virtual void flush() { }
+
+  size_t print(const char *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print((long)v); }
+  size_t print(unsigned int v) { return print((unsigned long)v); }
+  size_t print(long v) { return _printf("%ld", v); }
+  size_t print(unsigned long v) { return _printf("%lu", v); }
+  size_t print(double v, int digits = 2) { return _printf("%.*f", digits, v); }
+  size_t println() { return write("\r\n"); }
+  size_t println(const char *str) { return print(str) + println(); }
+  size_t println(long v) { return print(v) + println(); }
+  size_t println(unsigned long v) { return print(v) + println(); }
+
+private:
+  template <typename... T>
+  size_t _printf(const char *format, T... args) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), format, args...);
+    return write(buf);
+  }
+};
+
+#endif
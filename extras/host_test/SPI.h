@@ -0,0 +1,23 @@
+#ifndef SPI_h
+#define SPI_h
+
+#include <Arduino.h>
+
+#define SPI_MODE1 0x04
+
+struct SPISettings {
+  SPISettings(unsigned long, uint8_t, uint8_t) { }
+};
+
+// SPI is a reference, so that programs can bind it to a simulated port
+class SPIClass {
+public:
+  virtual ~SPIClass() { }
+  void begin() { }
+  void beginTransaction(SPISettings) { }
+  void endTransaction() { }
+  virtual uint8_t transfer(uint8_t) { return 0; }
+};
+extern SPIClass &SPI;
+
+#endif
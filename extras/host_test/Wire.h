@@ -0,0 +1,28 @@
+#ifndef Wire_h
+#define Wire_h
+
+#include <Arduino.h>
+
+#define BUFFER_LENGTH 32
+
+// Methods are virtual, so that programs can derive a simulated bus
+class TwoWire {
+public:
+  virtual ~TwoWire() { }
+  void begin() { }
+  void setClock(unsigned long) { }
+  virtual void beginTransmission(uint8_t) { }
+  virtual size_t write(uint8_t) { return 1; }
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buffer[n]))
+      ++n;
+    return n;
+  }
+  virtual uint8_t endTransmission() { return 0; }
+  virtual uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+};
+
+#endif
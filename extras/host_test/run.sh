@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds and runs the host tests against the stub Arduino core in this
+# directory.  Requires a C++11 host compiler.
+#
+# Usage: extras/host_test/run.sh    (CXX overrides the compiler)
+
+CXX=${CXX:-c++}
+DIR=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$DIR/../.." && pwd)
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+STATUS=0
+for TEST in "$DIR"/*_test.cpp; do
+  NAME=$(basename "$TEST" .cpp)
+  printf '%s: ' "$NAME"
+  if "$CXX" -std=gnu++11 -Wall -I"$DIR" -I"$ROOT" "$TEST" -o "$BUILD/$NAME" &&
+     "$BUILD/$NAME"; then
+    :
+  else
+    STATUS=1
+  fi
+done
+exit $STATUS
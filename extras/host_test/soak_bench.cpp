@@ -0,0 +1,640 @@
+// Soak benchmark: runs realistic workloads (touch painting, a dashboard,
+// a text console and a bitmap slideshow) through the real backends
+// (DigoleSerial, DigoleI2C, DigoleSPI and DigoleSoftSPI), each talking to a
+// simulated port: a UART with a transmit buffer, an I2C bus, an SPI
+// peripheral and GPIO pins.  At the far end, an emulated controller parses
+// the command stream, charges each command a fixed processing time and
+// answers reads.  Build and run it with extras/soak_baseline.sh.
+//
+// For every workload and link it prints one JSON line, with throughput and
+// p50/p99/p999 latencies (in us) per command class and per frame, and the
+// number of bytes the controller could not parse (a corrupted stream).
+//
+// Everything runs in emulated time, so results are repeatable: a command's
+// latency runs from when the library handed its first byte to the port
+// until the controller is done with it (for reads, until the library has
+// the reply).  Library CPU time isn't counted, except for the cost of pin
+// toggles when bit-banging.  Percentiles come from log-scale histograms
+// (two buckets per power of two), so they are upper bounds within 50%.
+
+#define DIGOLE_SERIAL 1
+#define DIGOLE_I2C 1
+#define DIGOLE_SPI 1
+#include <Digole.h>
+#include <DigoleWidgets.h>
+
+#include <stdio.h>
+
+const uint16_t FRAMES = 200;  // per workload and link
+
+
+/**** Emulated time, in ns ****/
+
+static uint64_t now_ns;
+
+unsigned long millis() { return (unsigned long)(now_ns / 1000000); }
+unsigned long micros() { return (unsigned long)(now_ns / 1000); }
+void delay(unsigned long ms) { now_ns += ms * 1000000ULL; }
+void delayMicroseconds(unsigned int us) { now_ns += us * 1000ULL; }
+void yield() { now_ns += 1000; }
+void pinMode(uint8_t, uint8_t) { }
+void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t) { }
+uint8_t shiftIn(uint8_t, uint8_t, uint8_t) { return 0; }
+
+
+/**** Latency histograms ****/
+
+class Histogram {
+public:
+  void reset() {
+    memset(_counts, 0, sizeof(_counts));
+    _total = 0;
+  }
+
+  void add(uint32_t us) {
+    ++_counts[_bucket(us)];
+    ++_total;
+  }
+
+  inline uint32_t count() const { return _total; }
+
+  // Upper bound of the q-th permille
+  uint32_t percentile(uint16_t q) const {
+    uint32_t target = (_total * q + 999) / 1000, seen = 0;
+    for (uint8_t i = 0;  i < BUCKETS;  i++) {
+      seen += _counts[i];
+      if (seen >= target && seen > 0)
+        return _upper(i);
+    }
+    return 0;
+  }
+
+private:
+  static const uint8_t BUCKETS = 60;
+
+  static uint8_t _bucket(uint32_t us) {
+    if (us < 2)
+      return 0;
+    uint8_t b = 1;
+    while (us >> (b + 1))
+      ++b;
+    uint8_t i = 2 * b + ((us >> (b - 1)) & 1);
+    return (i < BUCKETS) ? i : BUCKETS - 1;
+  }
+
+  static uint32_t _upper(uint8_t i) {
+    if (i < 2)
+      return 1;
+    uint8_t b = i / 2;
+    return (1UL << b) + ((i % 2) + 1) * (1UL << (b - 1)) - 1;
+  }
+
+  uint32_t _counts[BUCKETS];
+  uint32_t _total;
+};
+
+enum command_class_t : uint8_t {
+  CLASS_TEXT, CLASS_DRAW, CLASS_BITMAP, CLASS_STATE, CLASS_READ,
+  NUM_CLASSES
+};
+
+const char *const CLASS_NAMES[NUM_CLASSES] = {
+  "text", "draw", "bitmap", "state", "read"
+};
+
+
+/**** Emulated controller ****/
+
+// Argument formats: 'b' byte, 'i' raw int (see copyRawInt()), 't' text up
+// to '\r'.  No name may be a prefix of another.
+struct CommandInfo {
+  const char *name;
+  const char *args;
+  uint8_t cls;
+  uint8_t reply;  // bytes
+};
+
+const CommandInfo COMMANDS[] = {
+  { "CL", "", CLASS_DRAW },       { "CS", "b", CLASS_STATE },
+  { "DC", "b", CLASS_STATE },     { "SD", "b", CLASS_STATE },
+  { "CT", "b", CLASS_STATE },     { "BL", "b", CLASS_STATE },
+  { "ESC", "bbb", CLASS_STATE },  { "SC", "b", CLASS_STATE },
+  { "BGC", "", CLASS_STATE },     { "DM", "b", CLASS_STATE },
+  { "DP", "iib", CLASS_DRAW },    { "LN", "iiii", CLASS_DRAW },
+  { "LT", "ii", CLASS_DRAW },     { "DR", "iiii", CLASS_DRAW },
+  { "FR", "iiii", CLASS_DRAW },   { "CC", "iiib", CLASS_DRAW },
+  { "MA", "iiiibb", CLASS_DRAW }, { "SLP", "b", CLASS_STATE },
+  { "GP", "ii", CLASS_STATE },    { "DWWIN", "iiii", CLASS_STATE },
+  { "RSTDW", "", CLASS_STATE },   { "WINCL", "", CLASS_DRAW },
+  { "SF", "b", CLASS_STATE },     { "ETP", "ii", CLASS_TEXT },
+  { "TP", "ii", CLASS_TEXT },     { "ETB", "", CLASS_TEXT },
+  { "ETO", "bb", CLASS_TEXT },    { "TT", "t", CLASS_TEXT },
+  { "TRT", "", CLASS_TEXT },
+  { "RPNXY", "b", CLASS_READ, 4 },
+  { "RDBAT", "", CLASS_READ, 2 }, { "RDAUX", "", CLASS_READ, 2 },
+  { "RDTMP", "", CLASS_READ, 2 },
+  { "DIM", "iiii", CLASS_BITMAP },
+  { "EDIM1", "iiii", CLASS_BITMAP }, { "EDIM3", "iiii", CLASS_BITMAP },
+};
+
+const uint8_t NUM_COMMANDS = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+// Parses the bytes arriving from a port, processes one command at a time,
+// and queues replies for the port to send back
+class Controller {
+public:
+  const static uint32_t COMMAND_NS = 50000;  // processing time per command
+
+  void reset() {
+    _name_len = 0;
+    _command = NULL;
+    _done = now_ns;
+    _reply_len = _reply_pos = 0;
+    bytes = errors = 0;
+    for (uint8_t i = 0;  i < NUM_CLASSES;  i++)
+      histograms[i].reset();
+  }
+
+  // A byte the library handed to the port at issued, arriving at arrived
+  void receive(uint8_t c, uint64_t issued, uint64_t arrived) {
+    ++bytes;
+    if (_command == NULL) {
+      if (_name_len == 0)
+        _issued = issued;
+      _name[_name_len++] = c;
+      _match(arrived);
+    } else if (_payload > 0) {
+      if (--_payload == 0)
+        _finish(arrived);
+    } else {
+      _argument(c, arrived);
+    }
+  }
+
+  // When the controller is done with everything received so far
+  inline uint64_t done() const { return _done; }
+
+  inline bool replyPending() const { return _reply_pos < _reply_len; }
+  inline uint64_t replyReady() const { return _reply_ready; }
+
+  // Hands over the next reply byte (0xff if there is none)
+  uint8_t takeReply() {
+    if (!replyPending()) {
+      ++errors;
+      return 0xff;
+    }
+    uint8_t c = _reply[_reply_pos++];
+    if (!replyPending())
+      histograms[CLASS_READ].add((uint32_t)((now_ns - _reply_issued) / 1000));
+    return c;
+  }
+
+  // Replies to touchscreen reads
+  uint16_t touch_x, touch_y;
+
+  Histogram histograms[NUM_CLASSES];
+  uint32_t bytes, errors;
+
+private:
+  void _match(uint64_t arrived) {
+    bool prefix = false;
+    for (uint8_t i = 0;  i < NUM_COMMANDS;  i++) {
+      const char *name = COMMANDS[i].name;
+      if (strncmp(name, (const char *)_name, _name_len) != 0)
+        continue;
+      if (name[_name_len] != '\0') {
+        prefix = true;
+        continue;
+      }
+      _command = &COMMANDS[i];
+      _arg = 0;
+      _int_len = 0;
+      _payload = 0;
+      if (_command->args[0] == '\0')
+        _finish(arrived);
+      return;
+    }
+    if (!prefix) {
+      errors += _name_len;  // Drop it all, and resync on the next byte
+      _name_len = 0;
+    }
+  }
+
+  void _argument(uint8_t c, uint64_t arrived) {
+    switch (_command->args[_arg]) {
+    case 't':
+      if (c != '\r')
+        return;
+      break;
+    case 'i':
+      if (_int_len == 0 && c == 255) {
+        _int_len = 1;
+        return;
+      }
+      if (_arg < 4)
+        _ints[_arg] = (_int_len > 0) ? 255 + c : c;
+      _int_len = 0;
+      break;
+    }
+    if (_command->args[++_arg] != '\0')
+      return;
+
+    if (_command->cls == CLASS_BITMAP) {
+      uint32_t w = _ints[2], h = _ints[3];
+      char type = _command->name[_command->name[0] == 'E' ? 4 : 0];
+      _payload = (type == 'D') ? h * ((w + 7) / 8) :
+                 (type == '3') ? 3 * w * h : w * h;
+      if (_payload > 0)
+        return;
+    }
+    _finish(arrived);
+  }
+
+  void _finish(uint64_t arrived) {
+    _done = ((arrived > _done) ? arrived : _done) + COMMAND_NS;
+    if (_command->reply > 0) {
+      uint16_t v[2] = { touch_x, touch_y };
+      for (uint8_t i = 0;  i < _command->reply;  i++)
+        _reply[i] = (uint8_t)(v[i / 2] >> ((i % 2) ? 0 : 8));
+      _reply_len = _command->reply;
+      _reply_pos = 0;
+      _reply_ready = _done;
+      _reply_issued = _issued;
+    } else {
+      histograms[_command->cls].add((uint32_t)((_done - _issued) / 1000));
+    }
+    _name_len = 0;
+    _command = NULL;
+  }
+
+  uint8_t _name[6];
+  uint8_t _name_len;
+  const CommandInfo *_command;
+  uint8_t _arg, _int_len;
+  uint16_t _ints[4];
+  uint32_t _payload;
+  uint64_t _issued, _done;
+
+  uint8_t _reply[4];
+  uint8_t _reply_len, _reply_pos;
+  uint64_t _reply_ready, _reply_issued;
+};
+
+Controller controller;
+
+
+/**** Simulated ports ****/
+
+// UART with a transmit buffer; write() blocks only once it is full
+class SimSerial : public HardwareSerial {
+public:
+  const static uint8_t TX_BUFFER = 64;  // as in the AVR core
+
+  void setBaud(unsigned long baud) {
+    _byte_ns = 10 * 1000000000ULL / baud;  // start + 8 data + stop bits
+    _line_free = now_ns;
+    _taken = 0;
+  }
+
+  size_t write(uint8_t c) override {
+    uint64_t t = now_ns;
+    _line_free = ((_line_free > t) ? _line_free : t) + _byte_ns;
+    controller.receive(c, t, _line_free);
+    if (_line_free - t > TX_BUFFER * _byte_ns)
+      now_ns = _line_free - TX_BUFFER * _byte_ns;
+    return 1;
+  }
+  using HardwareSerial::write;
+
+  void flush() override {
+    if (_line_free > now_ns)
+      now_ns = _line_free;
+  }
+
+  int available() override {
+    if (!controller.replyPending())
+      return 0;
+    // Replies come back one byte time apart, once the command is done
+    return (controller.replyReady() + (_taken + 1) * _byte_ns <= now_ns) ? 1 : 0;
+  }
+
+  int read() override {
+    if (!available())
+      return -1;
+    uint8_t c = controller.takeReply();
+    _taken = controller.replyPending() ? _taken + 1 : 0;
+    return c;
+  }
+
+private:
+  uint64_t _byte_ns, _line_free;
+  uint16_t _taken;
+};
+
+// I2C bus: every transaction costs a START, the address byte and a STOP.
+// Like Wire, it holds at most BUFFER_LENGTH bytes per transaction and
+// drops the rest.  A read stretches the clock until the reply is ready.
+class SimWire : public TwoWire {
+public:
+  void setClock(unsigned long clock) {
+    _bit_ns = 1000000000ULL / clock;
+    _rx_len = _rx_pos = 0;
+  }
+
+  void beginTransmission(uint8_t) override {
+    _tx_len = 0;
+  }
+
+  size_t write(uint8_t c) override {
+    if (_tx_len >= BUFFER_LENGTH)
+      return 0;
+    _tx[_tx_len] = c;
+    _issued[_tx_len++] = now_ns;
+    return 1;
+  }
+  using TwoWire::write;
+
+  uint8_t endTransmission() override {
+    uint64_t t = now_ns + _bit_ns + 9 * _bit_ns;  // START, address
+    for (uint8_t i = 0;  i < _tx_len;  i++) {
+      t += 9 * _bit_ns;  // 8 bits and ACK
+      controller.receive(_tx[i], _issued[i], t);
+    }
+    now_ns = t + _bit_ns;  // STOP
+    return 0;
+  }
+
+  uint8_t requestFrom(uint8_t, uint8_t n) override {
+    uint64_t t = now_ns + _bit_ns + 9 * _bit_ns;
+    if (controller.replyPending() && controller.replyReady() > t)
+      t = controller.replyReady();
+    _rx_len = _rx_pos = 0;
+    for (uint8_t i = 0;  i < n && i < sizeof(_rx);  i++) {
+      t += 9 * _bit_ns;
+      now_ns = t;
+      _rx[_rx_len++] = controller.takeReply();
+    }
+    now_ns = t + _bit_ns;
+    return _rx_len;
+  }
+
+  int available() override { return _rx_len - _rx_pos; }
+  int read() override { return (_rx_pos < _rx_len) ? _rx[_rx_pos++] : -1; }
+
+private:
+  uint64_t _bit_ns;
+  uint8_t _tx[BUFFER_LENGTH];
+  uint64_t _issued[BUFFER_LENGTH];
+  uint8_t _tx_len;
+  uint8_t _rx[4];
+  uint8_t _rx_len, _rx_pos;
+};
+
+// SPI peripheral and GPIO pins, for both DigoleSPI and DigoleSoftSPI.
+// Data goes out on MISO and replies come back on MOSI (see DigoleSoftSPI);
+// MOSI also signals a pending reply while SS is deasserted.
+enum { SS_PIN = 10, MOSI_PIN = 11, MISO_PIN = 12, CLK_PIN = 13 };
+
+class SimSPI : public SPIClass {
+public:
+  void setup(unsigned long clock, uint32_t pin_ns) {
+    _bit_ns = 1000000000ULL / clock;
+    _pin_ns = pin_ns;
+    memset(_pins, 0, sizeof(_pins));
+    _pins[SS_PIN] = HIGH;
+  }
+
+  uint8_t transfer(uint8_t c) override {
+    uint64_t t = now_ns;
+    now_ns += 8 * _bit_ns;
+    if (_reading)
+      return controller.takeReply();
+    controller.receive(c, t, now_ns);
+    return 0;
+  }
+
+  void pin(uint8_t pin, uint8_t value) {
+    now_ns += _pin_ns;
+    if (pin == SS_PIN && !value && _pins[SS_PIN]) {
+      // The library only deasserts SS to read right after asking
+      _reading = controller.replyPending() && controller.replyReady() <= now_ns;
+      _bits = 0;
+    }
+    if (pin == CLK_PIN && value && !_pins[CLK_PIN] && !_pins[SS_PIN])
+      _clock();
+    if (pin < sizeof(_pins))
+      _pins[pin] = value;
+  }
+
+  int pin(uint8_t pin) {
+    now_ns += _pin_ns;
+    if (pin != MOSI_PIN)
+      return (pin < sizeof(_pins)) ? _pins[pin] : LOW;
+    if (_pins[SS_PIN])
+      return (controller.replyPending() && controller.replyReady() <= now_ns) ? HIGH : LOW;
+    return (_reading && _bits > 0) ? (_shift >> (8 - _bits)) & 1 : LOW;
+  }
+
+private:
+  // Rising clock edge: sample a bit from the library, or present one
+  void _clock() {
+    if (_bits == 8)
+      _bits = 0;
+    if (_bits == 0) {
+      _issued = now_ns;
+      _shift = _reading ? controller.takeReply() : 0;
+    }
+    ++_bits;
+    if (!_reading) {
+      _shift = (uint8_t)((_shift << 1) | _pins[MISO_PIN]);
+      if (_bits == 8)
+        controller.receive(_shift, _issued, now_ns);
+    }
+  }
+
+  uint64_t _bit_ns, _issued;
+  uint32_t _pin_ns;
+  uint8_t _pins[20];
+  bool _reading;
+  uint8_t _bits, _shift;
+};
+
+HardwareSerial Serial;
+SimSerial sim_serial;
+SimWire sim_wire;
+SimSPI sim_spi;
+SPIClass &SPI = sim_spi;
+
+void digitalWrite(uint8_t pin, uint8_t value) { sim_spi.pin(pin, value); }
+int digitalRead(uint8_t pin) { return sim_spi.pin(pin); }
+
+
+/**** Workloads ****/
+
+const uint16_t IMAGE_SIZE = 32;
+const uint8_t IMAGE[IMAGE_SIZE * IMAGE_SIZE] PROGMEM = { 0x55 };
+
+template <class D>
+class Bench {
+public:
+  Bench(D &lcd) :
+    _lcd(lcd), _screen(lcd),
+    _title(0, 0, 160, 16, "Engine"),
+    _rpm(0, 20, 80, 16, " rpm"), _temp(80, 20, 80, 16, " C"),
+    _volts(0, 40, 80, 16, " mV"), _amps(80, 40, 80, 16, " mA"),
+    _load(0, 60, 160, 10), _fuel(0, 74, 160, 10) {
+    _screen.add(_title);
+    _screen.add(_rpm);  _screen.add(_temp);
+    _screen.add(_volts);  _screen.add(_amps);
+    _screen.add(_load);  _screen.add(_fuel);
+  }
+
+  void run(const char *link) {
+    static const struct {
+      const char *name;
+      void (Bench::*run)(uint16_t frame);
+    } WORKLOADS[] = {
+      { "paint", &Bench::paint },
+      { "dashboard", &Bench::dashboard },
+      { "console", &Bench::console },
+      { "slideshow", &Bench::slideshow },
+    };
+    for (uint8_t w = 0;  w < sizeof(WORKLOADS) / sizeof(WORKLOADS[0]);  w++) {
+      Histogram frames;
+      frames.reset();
+      controller.reset();
+
+      uint64_t start = now_ns;
+      for (uint16_t frame = 0;  frame < FRAMES;  frame++) {
+        uint64_t t = now_ns;
+        (this->*WORKLOADS[w].run)(frame);
+        _lcd.drain();
+        uint64_t shown = (controller.done() > now_ns) ? controller.done() : now_ns;
+        frames.add((uint32_t)((shown - t) / 1000));
+      }
+      // Let the controller catch up before the next workload
+      if (controller.done() > now_ns)
+        now_ns = controller.done();
+      _report(WORKLOADS[w].name, link, frames, (uint32_t)((now_ns - start) / 1000));
+    }
+  }
+
+  // FingerPaint-style: a few touch samples per frame, joined by lines
+  void paint(uint16_t frame) {
+    for (uint8_t i = 0;  i < 3;  i++) {
+      uint16_t t = frame * 3 + i;
+      controller.touch_x = 80 + (t * 7) % 60;
+      controller.touch_y = 64 + (t * 13) % 50;
+      uint16_t x, y;
+      _lcd.readTouchscreen(x, y, Digole::TOUCH_DOWN_NONBLOCKING);
+      if (frame > 0 || i > 0)
+        _lcd.drawLine(_last_x, _last_y, x, y);
+      _last_x = x;
+      _last_y = y;
+    }
+  }
+
+  // Dashboard: a few values change every frame, the rest occasionally
+  void dashboard(uint16_t frame) {
+    if (frame == 0)
+      _screen.invalidate();
+    _rpm.setValue(3000 + (frame * 37) % 500);
+    _load.setValue((frame * 3) % 100);
+    if (frame % 10 == 0) {
+      _temp.setValue(85 + frame / 50);
+      _volts.setValue(12400 - frame);
+      _amps.setValue(1500 + (frame * 11) % 300);
+    }
+    if (frame % 50 == 0)
+      _fuel.setValue(100 - frame / 4);
+    _screen.update();
+  }
+
+  // Text console: one log line per frame, clearing every screenful
+  void console(uint16_t frame) {
+    if (frame % 8 == 0) {
+      _lcd.clearScreen();
+      _lcd.setTextPosition(0, 0);
+    }
+    _lcd.print("t=");
+    _lcd.print(frame * 40UL);
+    _lcd.print(" v=");
+    _lcd.print(12.0 - frame / 100.0, 2);
+    _lcd.println(" ok");
+  }
+
+  // Slideshow: one 256-color bitmap per frame
+  void slideshow(uint16_t frame) {
+    _lcd.drawBitmap(Digole::BITMAP_256, (frame % 4) * IMAGE_SIZE, 0,
+                    IMAGE_SIZE, IMAGE_SIZE, IMAGE);
+  }
+
+private:
+  static void _printPercentiles(const Histogram &h) {
+    printf("{\"count\":%u,\"p50\":%u,\"p99\":%u,\"p999\":%u}",
+           (unsigned)h.count(), (unsigned)h.percentile(500),
+           (unsigned)h.percentile(990), (unsigned)h.percentile(999));
+  }
+
+  void _report(const char *workload, const char *link,
+               const Histogram &frames, uint32_t elapsed) {
+    printf("{\"workload\":\"%s\",\"link\":\"%s\",\"frames\":%u,\"bytes\":%u,"
+           "\"errors\":%u,\"elapsed_us\":%u,\"bytes_per_s\":%u,\"frame\":",
+           workload, link, (unsigned)FRAMES, (unsigned)controller.bytes,
+           (unsigned)controller.errors, (unsigned)elapsed,
+           (unsigned)((uint64_t)controller.bytes * 1000000 / (elapsed ? elapsed : 1)));
+    _printPercentiles(frames);
+    for (uint8_t i = 0;  i < NUM_CLASSES;  i++) {
+      if (controller.histograms[i].count() == 0)
+        continue;
+      printf(",\"%s\":", CLASS_NAMES[i]);
+      _printPercentiles(controller.histograms[i]);
+    }
+    printf("}\n");
+  }
+
+  D &_lcd;
+  uint16_t _last_x, _last_y;
+
+  Digole::Screen<D> _screen;
+  Digole::Label<D> _title;
+  Digole::Value<D> _rpm, _temp, _volts, _amps;
+  Digole::Bar<D> _load, _fuel;
+};
+
+template <class D>
+void bench(D &lcd, const char *link) {
+  Bench<D> b(lcd);
+  b.run(link);
+}
+
+
+int main() {
+  // Bit-banged pins are toggled through port registers (FastPin) rather
+  // than digitalWrite(), which DigoleSPI uses for SS
+  const uint32_t PORT_NS = 250, DIGITAL_WRITE_NS = 4000;
+
+  sim_serial.setBaud(115200);
+  Digole::DigoleSerial serial(sim_serial, 115200);
+  bench(serial, "serial-115200");
+
+  sim_wire.setClock(100000);
+  Digole::DigoleI2C i2c(sim_wire);
+  bench(i2c, "i2c-100k");
+
+  sim_wire.setClock(400000);
+  bench(i2c, "i2c-400k");
+
+  sim_spi.setup(100000, DIGITAL_WRITE_NS);
+  Digole::DigoleSPI spi(SS_PIN, MOSI_PIN);
+  spi.begin();
+  bench(spi, "spi-100k");
+
+  sim_spi.setup(1000000, PORT_NS);
+  Digole::DigoleSoftSPI<SS_PIN, MOSI_PIN, MISO_PIN, CLK_PIN> soft;
+  soft.begin();
+  bench(soft, "softspi");
+
+  printf("{\"done\":true}\n");
+  return 0;
+}
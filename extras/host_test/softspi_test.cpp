@@ -0,0 +1,126 @@
+// Host test for DigoleSoftSPI: drives the template through the digitalWrite
+// FastPin fallback against a simulated GPIO port that decodes what a
+// display would see on the wire.  Run with extras/host_test/run.sh.
+
+#define DIGOLE_SPI 1
+#include <Digole.h>
+
+#include <stdio.h>
+#include <string>
+
+HardwareSerial Serial;
+static SPIClass spi;
+SPIClass &SPI = spi;
+
+enum { SS = 10, MOSI = 11, MISO = 12, CLK = 13 };
+
+// Simulated display end of the link.  Data comes in on MISO, sampled on
+// the rising clock edge (as shiftOut() does); replies go out on MOSI.
+static uint8_t pins[20];
+static std::string received;    // bytes clocked in, per completed frame
+static int frames;              // SS assertions
+static int bits;                // bits of the current byte
+static uint8_t shift;           // current byte
+static std::string reply;       // bytes to shift out on MOSI, in order
+static int gaps;                // delayMicroseconds() calls while SS is low
+static int failures;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    ++failures;
+  }
+}
+
+unsigned long millis() { return 0; }
+unsigned long micros() { return 0; }
+void delay(unsigned long) { }
+void yield() { }
+void pinMode(uint8_t, uint8_t) { }
+void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t) { }
+uint8_t shiftIn(uint8_t, uint8_t, uint8_t) { return 0; }
+
+void delayMicroseconds(unsigned int) {
+  if (!pins[SS])
+    ++gaps;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin == CLK && value && !pins[CLK]) {
+    check(!pins[SS], "clock edge while SS is deasserted");
+    shift = (uint8_t)((shift << 1) | pins[MISO]);
+    if (++bits == 8) {
+      received += (char)shift;
+      bits = 0;
+    }
+  }
+  if (pin == SS && value != pins[SS]) {
+    if (!value)
+      ++frames;
+    else
+      check(bits == 0, "SS released in the middle of a byte");
+  }
+  pins[pin] = value;
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin != MOSI)
+    return pins[pin];
+  if (pins[SS])
+    return reply.empty() ? LOW : HIGH;  // Signals a reply is ready
+  // MSB first; the host samples while the clock is high
+  uint8_t bit = (uint8_t)(7 - (bits + 7) % 8);
+  uint8_t v = (uint8_t)reply[0];
+  if (bit == 0)
+    reply.erase(0, 1);  // Last bit of this byte
+  return (v >> bit) & 1;
+}
+
+template <class D>
+static void reset(D &lcd) {
+  lcd.flush();
+  received.clear();
+  frames = 0;
+  gaps = 0;
+}
+
+int main() {
+  pins[SS] = HIGH;
+
+  Digole::DigoleSoftSPI<SS, MOSI, MISO, CLK> lcd;
+  lcd.begin();
+
+  // One SS frame per write, bytes MSB first
+  reset(lcd);
+  lcd.writeRaw("CL", 2);
+  lcd.setColor(0xA5);
+  lcd.print("hi");
+  lcd.flush();
+  check(frames == 3, "one frame per write");
+  check(received == std::string("CLSC\xA5TThi\r"), "bytes and bit order");
+
+  // The default gap leaves the display time between bytes
+  reset(lcd);
+  static const uint8_t bytes[] = { 0x00, 0xff, 0x81, 0x7e, 0x5a };
+  lcd.writeRaw(bytes, sizeof(bytes));
+  check(frames == 1, "a buffer stays in one frame");
+  check(received == std::string((const char *)bytes, sizeof(bytes)), "buffer contents");
+  check(gaps == 1 + (int)sizeof(bytes) - 1, "a gap between bytes");
+
+  // BYTE_GAP = 0 sends bytes back to back
+  Digole::DigoleSoftSPI<SS, MOSI, MISO, CLK, 0> fast;
+  reset(fast);
+  fast.writeRaw(bytes, sizeof(bytes));
+  check(received == std::string((const char *)bytes, sizeof(bytes)), "buffer contents without gap");
+  check(gaps == 1, "no gap between bytes");
+
+  // Replies are read MSB first, one frame per byte
+  reset(lcd);
+  reply = std::string("\xC3\x12\x34", 3);
+  check(lcd.read() == 0xC3, "read()");
+  check(lcd.readInt() == 0x1234, "readInt()");
+  check(frames == 3 && reply.empty(), "one frame per reply byte");
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Prints, for every backend, the flash/RAM saved by switching off each
+# setting when compiling examples/SizeReport.  Command groups cost nothing
+# unless called, so for those this is the cost of the calls the sketch
+# makes; the other settings change what every display object carries.
+# Requires arduino-cli and the board's core.
+#
+# Usage: extras/size_report.sh [fqbn]    (default: arduino:avr:uno)
+
+FQBN=${1:-arduino:avr:uno}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SKETCH="$ROOT/examples/SizeReport"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+# Prints "<flash> <ram>" for the given compiler flags
+size_of() {
+  arduino-cli compile --fqbn "$FQBN" --library "$ROOT" --build-path "$BUILD" \
+      --build-property "compiler.cpp.extra_flags=$*" "$SKETCH" 2>&1 |
+    sed -n -e 's/^Sketch uses \([0-9]*\) bytes.*/\1/p' \
+           -e 's/^Global variables use \([0-9]*\) bytes.*/\1/p' |
+    tr '\n' ' '
+}
+
+printf '%-8s %-26s %8s %8s\n' backend "switched off" flash ram
+for BACKEND in SERIAL I2C SPI; do
+  set -- $(size_of "-DDIGOLE_$BACKEND=1")
+  FLASH=$1 RAM=$2
+  printf '%-8s %-26s %8s %8s\n' "$BACKEND" "(none; total)" "$FLASH" "$RAM"
+  for FEATURE in DIGOLE_ENABLE_TOUCH DIGOLE_ENABLE_UPLOAD DIGOLE_ENABLE_FLASH \
+                 DIGOLE_ENABLE_CHARLCD DIGOLE_ENABLE_INTERACTIVE \
+                 DIGOLE_ENABLE_STATS DIGOLE_TEXT_BUFFER REENTRANT; do
+    set -- $(size_of "-DDIGOLE_$BACKEND=1 -D$FEATURE=0")
+    printf '%-8s %-26s %8d %8d\n' "$BACKEND" "$FEATURE" \
+      $((FLASH - $1)) $((RAM - $2))
+  done
+done
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds the host soak benchmark (extras/host_test/soak_bench.cpp) and
+# captures its JSON lines into a baseline file (one line per workload and
+# link), for comparison after protocol or transport changes.  Results are
+# in emulated time, so a rerun without changes gives the same file.
+#
+# Usage: extras/soak_baseline.sh <baseline.jsonl>    (CXX overrides the compiler)
+
+OUT=${1:?output file}
+CXX=${CXX:-c++}
+DIR=$(cd "$(dirname "$0")/host_test" && pwd)
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+"$CXX" -std=gnu++11 -O2 -I"$DIR" -I"$DIR/../.." "$DIR/soak_bench.cpp" \
+    -o "$BUILD/soak_bench" || exit 1
+# Stop at the end marker
+"$BUILD/soak_bench" | sed -n -e '/^{"workload"/p' -e '/^{"done"/q' > "$OUT" || exit 1
+echo "$(wc -l < "$OUT") results written to $OUT"